@@ -66,8 +66,10 @@ void data_in(unsigned char* buffer, int received, signed char steps){
     t_h->sample_size = received;
     t_h->steps_per_trace = steps;
     t_h->trace_index_in_fold = trace_count;
-    liberad_write_trace(file, t_h, buffer);
-    trace_count++;
+    //queue trace for the writer thread - never blocks on disk I/O
+    if (liberad_write_trace_async(file, t_h, buffer) == SUCCESS){
+      trace_count++;
+    }
   }
 }
 
@@ -109,6 +111,9 @@ void start_logging(){
   //init trace header struct
   t_h = new EradTraceHeader();
 
+  //start writer thread
+  liberad_start_async_write(file, LIBERAD_ASYNC_SLOT_COUNT, IN_BUFFER_SIZE);
+
   trace_count = 0;
   logging = true;
 }
@@ -116,9 +121,15 @@ void start_logging(){
 //stop logging gpr data to file
 void stop_logging(){
   logging = false;
-  // finish file write (writes total trace count to file)
+
+  // finish file write (drains the queue, writes total trace count to file)
   liberad_finish_write(file);
 
+  // report traces lost to a full queue - after the drain so that written counts every queued trace
+  EradAsyncWriteStats stats;
+  liberad_get_async_write_stats(file, &stats);
+  printf ("written: %ld dropped: %ld overruns: %ld max queue depth: %ld \n", stats.written, stats.dropped, stats.overruns, stats.max_queue_depth);
+
   // close file
   liberad_close_file(file);
 
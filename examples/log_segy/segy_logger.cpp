@@ -20,7 +20,6 @@ SegyTraceHeader* t_h = nullptr;
 
 atomic<bool> running;
 atomic<bool> logging;
-int trace_count;
 
 void user_input();
 void data_in(unsigned char* buffer, int received, signed char steps);
@@ -63,11 +62,12 @@ int main(){
 //callback on new data from GPR
 void data_in(unsigned char* buffer, int received, signed char steps){
   if (logging){
-    // set necessary fields for segy trace header
-    t_h->traceSequenceNumInLine = trace_count;
-    t_h->traceSequenceNumInFile = trace_count;
-    t_h->originalRecordNum = trace_count;
-    t_h->ensembleNum = trace_count;
+    // set necessary fields for segy trace header - the file keeps a running count of traces written
+    int32_t trace_num = static_cast<int32_t>(file->trace_count) + 1;
+    t_h->traceSequenceNumInLine = trace_num;
+    t_h->traceSequenceNumInFile = trace_num;
+    t_h->originalRecordNum = trace_num;
+    t_h->ensembleNum = trace_num;
     t_h->numSamples = received;
 
     // record time
@@ -75,10 +75,8 @@ void data_in(unsigned char* buffer, int received, signed char steps){
     // t_h->minute = minute;
     // t_h->second = second;
 
-    //write trace data
+    //append trace to the file's write buffer - written out sequentially when full and on close
     liberad_write_segy_trace(file, t_h, buffer, received);
-
-    trace_count++;
   }
 }
 
@@ -133,14 +131,13 @@ void start_logging(){
   // incoming data in the data_in(..) callback should be cast to a suitable format. 
   bin_header.formatCode = SegyBinaryHeader::BYTE_1_UNS;
 
-  //write binary header to file
+  //write binary header to file. numOfTracesInFile is filled in when the file is closed
   liberad_write_segy_bin_h(file, &bin_header);
 
   //init trace header struct for reuse on incoming data from gpr
   t_h = new SegyTraceHeader();
 
   // init logging params
-  trace_count = 0;
   logging = true;
 }
 
@@ -148,7 +145,8 @@ void start_logging(){
 void stop_logging(){
   logging = false;
 
-  // close file
+  // close file - writes out buffered traces and the trace count
+  cout << "traces logged: " << file->trace_count << endl;
   liberad_close_segy_file_w(file);
 
   //clear resources
@@ -2,18 +2,35 @@
 #define LIBERAD_ERAD
 
 #include <string>
+#include <vector>
+#include <cstdint>
 
 #define FH_SIZE 212
 
 #define TH_SIZE_VER_1 55
 #define TH_SIZE_VER_2 66
 
+#define LIBERAD_PREFETCH_CHUNK_SIZE (4 * 1024 * 1024)
+#define LIBERAD_PREFETCH_CHUNK_COUNT 4
+
+#define LIBERAD_CACHE_BLOCK_TRACES 256
+
+#define LIBERAD_ASYNC_SLOT_COUNT 1024
+
+#define LIBERAD_DIRECT_BUFFER_SIZE (4 * 1024 * 1024)
+#define LIBERAD_PREALLOCATE_SIZE (64 * 1024 * 1024)
+
+#define LIBERAD_COMPRESSED_BLOCK_TRACES 64
+
+#define LIBERAD_INDEX_EXTENSION ".idx"
+#define LIBERAD_INDEX_VERSION 0x01
+
 
 namespace liberad{
 
   enum LiberadExitCodes{ERROR = -1, SUCCESS = 0};
   enum RadarType{SCUDO = 0x09, DIPOLO = 0x0B, CONCRETTO = 0x0A, CUSTOM = 0x08};
-  enum FileVersion{VER_2018 = 0x03, VER_2019 = 0x04};
+  enum FileVersion{VER_2018 = 0x03, VER_2019 = 0x04, VER_2019_COMPRESSED = 0x05};
   enum HardwareVersion{PRE2017 = 0x01, POST2017 = 0x05};
   enum Dimension{SINGLE_SLICE_TEMPORAL = 0x00, SINGLE_SLICE_SPATIAL = 0x01, VERTICAL_3D = 0x02, HORIZONTAL_3D = 0x03, VERTICAL_HORIZONTAL = 0x04,
                 VERTICAL_SLICES_TEMPORAL= 0x05, HORIZONTAL_SLICES_TEMPORAL = 0x06, VER_HOR_TEMPORAL = 0x07};
@@ -22,6 +39,8 @@ namespace liberad{
 
   enum EndiannessMarker{BIG_END = 0x00, LITTLE_END = 0x02};
 
+  enum CompressionMode{COMPRESSION_NONE = 0x00, COMPRESSION_FAST = 0x01, COMPRESSION_HIGH = 0x02};
+
 }
 
 
@@ -91,9 +110,80 @@ struct EradTraceHeader_VER_1{
 };
 
 
+/* Structure-of-arrays view of the trace headers of a whole file - one entry per trace in every column.
+*/
+struct EradTraceIndex{
+
+  int64_t file_size = 0;
+  int64_t trace_count = 0;
+
+  std::vector<double> x_local;
+  std::vector<double> y_local;
+  std::vector<double> latitude;
+  std::vector<double> longitude;
+  std::vector<int8_t> hour;
+  std::vector<int8_t> minute;
+  std::vector<int8_t> second;
+  std::vector<int16_t> millisecond;
+  std::vector<int32_t> fold_index;
+  std::vector<int8_t> fold_orientation;
+
+};
+
+
+/* A run of consecutive traces sharing fold_index and fold_orientation, with the bounding box of their local coordinates.
+*/
+struct EradFold{
+
+  int32_t fold_index = 0;
+  int8_t fold_orientation = 0;
+  int64_t first_trace = 0;
+  int64_t trace_count = 0;
+  double min_x = 0;
+  double max_x = 0;
+  double min_y = 0;
+  double max_y = 0;
+
+};
+
+
+/* Counters of the in-library trace cache - see liberad_set_trace_cache
+*/
+struct EradCacheStats{
+
+  int64_t hits = 0;
+  int64_t misses = 0;
+  int64_t cached_blocks = 0;
+  int64_t cached_bytes = 0;
+
+};
+
+
+/* Counters of the async writer - see liberad_start_async_write
+*/
+struct EradAsyncWriteStats{
+
+  int64_t queue_depth = 0;
+  int64_t max_queue_depth = 0;
+  int64_t written = 0;
+  int64_t dropped = 0;
+  int64_t overruns = 0;
+
+};
+
+
+struct LiberadPrefetcher;
+struct LiberadTraceCache;
+struct LiberadAsyncWriter;
+struct LiberadDirectWriter;
+struct LiberadBlocks;
+struct LiberadUring;
+
+
 struct LiberadFile{
 
-  enum Mode{LIBERAD_WRITE, LIBERAD_READ, LIBERAD_APPEND};
+  enum Mode{LIBERAD_WRITE, LIBERAD_READ, LIBERAD_APPEND, LIBERAD_READ_MMAP, LIBERAD_READ_POSITIONAL};
+  enum AccessHint{LIBERAD_ACCESS_NORMAL, LIBERAD_ACCESS_SEQUENTIAL, LIBERAD_ACCESS_RANDOM};
 
   LiberadFile();
   LiberadFile(Mode mode);
@@ -101,9 +191,12 @@ struct LiberadFile{
   ~LiberadFile();
 
   EradFileHeader* f_header = nullptr;
+  // file header read by functions called before liberad_get_file_info, f_header then points here
+  EradFileHeader header;
   Mode mode = LIBERAD_READ;
   liberad::EndiannessMarker endianness = liberad::LITTLE_END;
   FILE* stream = nullptr;
+  int fd = -1;
 
   const char* filename = nullptr;
   int8_t file_ver = liberad::VER_2019;
@@ -111,8 +204,46 @@ struct LiberadFile{
   int64_t trace_count = 0;
   bool is_open = false;
   bool is_valid = false;
-
-  //TODO fold data array with fold trace counts
+  // trace_count derived from file size - the file has no valid trailer
+  bool is_recovered = false;
+
+  // LIBERAD_READ_MMAP only - whole file mapped read-only
+  uint8_t* map = nullptr;
+  int64_t map_size = 0;
+  AccessHint access_hint = LIBERAD_ACCESS_NORMAL;
+
+  // background read-ahead for sequential scans - see liberad_enable_prefetch
+  LiberadPrefetcher* prefetcher = nullptr;
+
+  // write buffer - disabled (nullptr) by default, see liberad_set_write_buffer
+  uint8_t* write_buffer = nullptr;
+  int64_t write_buffer_size = 0;
+  int64_t write_buffer_used = 0;
+  int flush_interval_ms = 0;
+  int64_t last_flush_ms = 0;
+  // periodic trace_count trailer - see liberad_set_checkpoint_interval
+  int checkpoint_interval_ms = 0;
+  int64_t last_checkpoint_ms = 0;
+  // O_DIRECT output of the write buffer - see liberad_set_direct_write
+  LiberadDirectWriter* direct_writer = nullptr;
+
+  // lock-free queue drained by a writer thread - see liberad_start_async_write
+  LiberadAsyncWriter* async_writer = nullptr;
+  // final counters of the last stopped writer
+  EradAsyncWriteStats async_stats;
+
+  // VER_2019_COMPRESSED only - block index and codec state, see liberad_set_compression
+  LiberadBlocks* blocks = nullptr;
+
+  // io_uring of liberad_get_traces - set up by the first batch, closed with the file
+  LiberadUring* uring = nullptr;
+
+  // bounded LRU cache of trace blocks - disabled (nullptr) by default, see liberad_set_trace_cache
+  LiberadTraceCache* cache = nullptr;
+
+  // fold table - populated lazily by liberad_get_fold_count / liberad_get_fold
+  std::vector<EradFold> folds;
+  bool folds_loaded = false;
 
 };
 
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <iostream>
+#include <type_traits>
 #include "erad.h"
 #include "segy.h"
 
@@ -27,7 +28,10 @@ T shift_endianness(T source){
 /* Opens an instance of LiberadFile at location file in mode
 * @param LiberadFile* efile - pointer to instance of .erad file
 * @param const char* file_loc - path of file for read/write
-* @param LiberadFile::Mode mode - READ or WRITE
+* @param LiberadFile::Mode mode - READ, READ_MMAP (memory mapped read), READ_POSITIONAL (pread based read, trace reads
+* are safe to issue from several threads once file info has been read), WRITE or APPEND (continues an existing VER_2019
+* log or starts a new one - trace_count is restored and doubles as the next trace_index, the trailer is overwritten and
+* rewritten by liberad_finish_write)
 * @return -1 on ERROR, 0 on SUCCESS
 */
 int liberad_open_file(LiberadFile* efile, const char* file_loc, LiberadFile::Mode mode);
@@ -44,9 +48,17 @@ int liberad_open_file(LiberadFile* efile);
 */
 bool liberad_check_file(LiberadFile* efile);
 
+/* Sets the paging hint of a file opened in LIBERAD_READ_MMAP mode. Can be set before opening the file.
+* @param LiberadFile* efile - pointer to .erad file instance
+* @param LiberadFile::AccessHint hint - NORMAL, SEQUENTIAL (full passes) or RANDOM (scattered trace fetches)
+*/
+void liberad_set_access_hint(LiberadFile* efile, LiberadFile::AccessHint hint);
+
 /* ----------------------------------------------------------------------------------------------------------------- */
 
 /* Extracts basic information about .erad file - filesize, trace_count and reads the file header into EradFileHeader f_header struct instance
+* Files without a valid trace_count trailer (unfinished logs) are recovered: trace_count is derived from the file size and
+* checked against the last few trace headers, and efile->is_recovered is set.
 * @param LiberadFile* efile - pointer to opened and valid .erad file instance
 * @param EradFileHeader* f_header - pointer to file header struct to populate
 */
@@ -74,24 +86,182 @@ void liberad_get_trace_header_at(LiberadFile* efile, int64_t trace_index, EradTr
 */
 void liberad_get_trace_data_at(LiberadFile* efile, int64_t trace_index, uint8_t* data);
 
+/* Returns a zero-copy view of the raw trace data at trace_index. Only available in LIBERAD_READ_MMAP mode.
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance
+* @param int64_t trace_index - trace index within file
+* @return pointer to f_header->sample_size samples inside the mapped file, valid until the file is closed. nullptr on ERROR
+*/
+const uint8_t* liberad_get_trace_data_view_at(LiberadFile* efile, int64_t trace_index);
+
+/* Reads trace header of trace with trace_index in t_header and returns a zero-copy view of its raw trace data.
+* Only available in LIBERAD_READ_MMAP mode.
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance
+* @param int64_t trace_index - trace index within file
+* @param  EradTraceHeader* t_header - pointer to trace header struct to populate
+* @return pointer to f_header->sample_size samples inside the mapped file, valid until the file is closed. nullptr on ERROR
+*/
+const uint8_t* liberad_get_trace_view_at(LiberadFile* efile, int64_t trace_index, EradTraceHeader* t_header);
+
 
 /* ----------------------------------------------------------------------------------------------------------------- */
 
-//TODO
-/*
+/* Reads raw trace data of traces index_start to index_end (inclusive) with a few large contiguous reads
 * @param  LiberadFile* efile - pointer to opened and valid .erad file instance
-*
+* @param int64_t index_start - index of first trace to read
+* @param int64_t index_end - index of last trace to read
+* @param uint8_t* data - pointer to uint8_t buffer - must be at least (index_end - index_start + 1) * f_header->sample_size big
 */
 void liberad_get_trace_data(LiberadFile* efile, int64_t index_start, int64_t index_end, uint8_t* data);
 
-//TODO
-/*
-*
+/* Writes raw trace data of traces index_start to index_end (inclusive) to out_stream
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance
+* @param int64_t index_start - index of first trace to read
+* @param int64_t index_end - index of last trace to read
+* @param std::ostream* out_stream - stream receiving (index_end - index_start + 1) * f_header->sample_size bytes
 */
 void liberad_get_trace_data(LiberadFile* efile, int64_t index_start, int64_t index_end, std::ostream* out_stream);
 
-//TODO
-//void liberad_get_trace_data(LiberadFile* efile, int index_start, int index_end, callbackfunction* functor);
+/* Callback type for streaming trace iteration
+* @param const EradTraceHeader* t_header - decoded header of current trace
+* @param const uint8_t* data - f_header->sample_size raw samples of current trace
+* @param void* user_data - pointer passed through from the caller
+*/
+typedef void (*LiberadTraceCallback)(const EradTraceHeader* t_header, const uint8_t* data, void* user_data);
+
+/* Streams traces index_start to index_end (inclusive) through callback. Reads large spans internally - no per trace
+* seeks or allocations. t_header and data passed to callback are only valid during the call.
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance
+* @param int64_t index_start - index of first trace
+* @param int64_t index_end - index of last trace
+* @param LiberadTraceCallback callback - function invoked once per trace in file order
+* @param void* user_data - pointer passed to every callback invocation
+*/
+void liberad_get_trace_data(LiberadFile* efile, int64_t index_start, int64_t index_end, LiberadTraceCallback callback, void* user_data);
+
+/* Streams traces index_start to index_end (inclusive) through any callable (lambda, functor, std::function) with the
+* signature void(const EradTraceHeader* t_header, const uint8_t* data). See liberad_get_trace_data above.
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance
+* @param int64_t index_start - index of first trace
+* @param int64_t index_end - index of last trace
+* @param Functor&& functor - callable invoked once per trace in file order
+*/
+template<typename Functor>
+void liberad_for_each_trace(LiberadFile* efile, int64_t index_start, int64_t index_end, Functor&& functor){
+  typedef typename std::remove_reference<Functor>::type FunctorType;
+  liberad_get_trace_data(efile, index_start, index_end, [](const EradTraceHeader* t_header, const uint8_t* data, void* user_data){
+    (*static_cast<FunctorType*>(user_data))(t_header, data);
+  }, const_cast<void*>(static_cast<const void*>(&functor)));
+}
+
+/* ----------------------------------------------------------------------------------------------------------------- */
+
+/* Reads a batch of scattered traces by index. On Linux the reads are submitted together through io_uring and complete
+* out of order into their caller slots; elsewhere, or if io_uring is unavailable, they fall back to preadv.
+* Safe to call from several threads on a LIBERAD_READ_POSITIONAL or LIBERAD_READ_MMAP instance.
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance with file info read
+* @param const int64_t* indices - trace indices to read, in any order
+* @param size_t n - number of indices
+* @param EradTraceHeader* t_headers - array of n trace headers to populate, slot k for indices[k]. May be nullptr
+* @param uint8_t* data - buffer of at least n * f_header->sample_size bytes, samples of indices[k] at data + k * sample_size
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_get_traces(LiberadFile* efile, const int64_t* indices, size_t n, EradTraceHeader* t_headers, uint8_t* data);
+
+/* ----------------------------------------------------------------------------------------------------------------- */
+
+/* Configures the in-library LRU trace cache of efile, disabled by default. While enabled, liberad_get_trace_at,
+* liberad_get_trace_header_at and liberad_get_trace_data_at are served from cached blocks of consecutive traces.
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance with file info read
+* @param int64_t budget_bytes - memory budget of the cache, 0 disables it and frees all cached blocks. Budgets below one
+* block (block_traces traces with their headers) are rejected
+* @param int block_traces - traces read per cache fill, e.g. LIBERAD_CACHE_BLOCK_TRACES
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_set_trace_cache(LiberadFile* efile, int64_t budget_bytes, int block_traces);
+
+/* Reads hit/miss counters and current occupancy of efile's trace cache
+* @param  LiberadFile* efile - pointer to .erad file instance
+* @param EradCacheStats* stats - pointer to stats struct to populate
+*/
+void liberad_get_trace_cache_stats(LiberadFile* efile, EradCacheStats* stats);
+
+/* ----------------------------------------------------------------------------------------------------------------- */
+
+/* Starts background read-ahead for sequential passes over efile. While enabled, liberad_get_trace_at,
+* liberad_get_trace_header_at and liberad_get_trace_data_at are served from chunks read ahead on a separate thread.
+* Non-sequential access restarts the read-ahead at the requested trace. Not available in LIBERAD_READ_MMAP mode.
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance with file info read
+* @param int64_t chunk_size - approximate size in bytes of a single read, e.g. LIBERAD_PREFETCH_CHUNK_SIZE
+* @param int chunk_count - number of chunks kept in flight, e.g. LIBERAD_PREFETCH_CHUNK_COUNT
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_enable_prefetch(LiberadFile* efile, int64_t chunk_size, int chunk_count);
+
+/* Stops read-ahead of efile and frees its buffers. Called by liberad_close_file.
+* @param  LiberadFile* efile - pointer to .erad file instance
+*/
+void liberad_disable_prefetch(LiberadFile* efile);
+
+/* ----------------------------------------------------------------------------------------------------------------- */
+
+/* Populates index with the columnar trace header index of efile. Loads the sidecar file filename + LIBERAD_INDEX_EXTENSION
+* when it matches efile's size and trace count, otherwise scans all trace headers once and writes a new sidecar.
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance with file info read
+* @param EradTraceIndex* index - pointer to index to populate
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_get_trace_index(LiberadFile* efile, EradTraceIndex* index);
+
+/* Scans all trace headers of efile once into index columns. Does not touch the sidecar file.
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance with file info read
+* @param EradTraceIndex* index - pointer to index to populate
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_build_trace_index(LiberadFile* efile, EradTraceIndex* index);
+
+/* Writes index to a sidecar file
+* @param EradTraceIndex* index - pointer to populated index
+* @param const char* filename - location of sidecar file
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_save_trace_index(EradTraceIndex* index, const char* filename);
+
+/* Loads index from a sidecar file. Fails if the sidecar does not match efile's file size and trace count.
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance with file info read
+* @param EradTraceIndex* index - pointer to index to populate
+* @param const char* filename - location of sidecar file
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_load_trace_index(LiberadFile* efile, EradTraceIndex* index, const char* filename);
+
+/* ----------------------------------------------------------------------------------------------------------------- */
+
+/* Returns the number of folds of efile. Populates efile->folds on first call from the trace header index
+* (sidecar file or a single header scan, see liberad_get_trace_index).
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance with file info read
+* @return number of folds, -1 on ERROR
+*/
+int liberad_get_fold_count(LiberadFile* efile);
+
+/* Returns a fold's first trace, trace count and bounding coordinates. Populates efile->folds on first call.
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance with file info read
+* @param int fold - fold number in file order, 0 to liberad_get_fold_count(efile) - 1
+* @return pointer to fold entry in efile->folds, nullptr on ERROR
+*/
+EradFold* liberad_get_fold(LiberadFile* efile, int fold);
+
+/* Reads raw trace data of all traces of a fold with a bulk range read
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance with file info read
+* @param int fold - fold number in file order, 0 to liberad_get_fold_count(efile) - 1
+* @param uint8_t* data - pointer to uint8_t buffer - must be at least fold trace_count * f_header->sample_size big
+*/
+void liberad_get_fold_data(LiberadFile* efile, int fold, uint8_t* data);
+
+/* Builds efile->folds from an already populated trace header index
+* @param  LiberadFile* efile - pointer to .erad file instance
+* @param EradTraceIndex* index - trace header index of efile
+*/
+void liberad_build_fold_table(LiberadFile* efile, EradTraceIndex* index);
 
 /* ----------------------------------------------------------------------------------------------------------------- */
 
@@ -115,6 +285,13 @@ void liberad_get_file_size(LiberadFile* efile);
 */
 void liberad_read_trace_header(LiberadFile* efile, long int index_file, EradTraceHeader* t_header);
 
+/* Helper function for decoding a trace header already in memory
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance
+* @param const uint8_t* raw - packed on-disk trace header of efile's version and endianness
+* @param EradTraceHeader* t_header - pointer to EradTraceHeader struct to populate
+*/
+void liberad_decode_trace_header(LiberadFile* efile, const uint8_t* raw, EradTraceHeader* t_header);
+
 
 /* Helper function for reading file header from FILE stream into f_header
 * @param FILE* stream - pointer to opened and valid LiberadFile FILE stream instance
@@ -132,27 +309,134 @@ std::string liberad_get_radar_string(int16_t radar);
 
 /* ----------------------------------------------------------------------------------------------------------------- */
 
-/* Writes f_header to file
+/* Writes f_header to file. Refused for a LIBERAD_APPEND instance resuming a non-empty log, which has its header already
 * @param  LiberadFile* efile - pointer to opened and valid .erad file instance
 * @param EradFileHeader* f_header - pointer to header to write to file
 */
 void liberad_write_file_header(LiberadFile* efile, EradFileHeader* f_header);
 
-/* Writes theader to file
+/* Writes theader to file at the offset of theader->trace_index. In LIBERAD_APPEND mode traces always go after the ones
+* already in the log, whatever their trace_index
 * @param  LiberadFile* efile - pointer to opened and valid .erad file instance
 * @param EradTraceHeader* theader - pointer to header to write to file
 * @param uint8_t* data - trace data
 */
 void liberad_write_trace(LiberadFile* efile, EradTraceHeader* theader, uint8_t* data);
 
+/* Writes n traces at once with vectored I/O (writev/pwritev) - one system call per up to 512 traces instead of
+* a seek, header and data write and flush per trace. Traces are written consecutively starting at headers[0].trace_index,
+* or after the already written data when a write buffer is set or in LIBERAD_APPEND mode.
+* @param  LiberadFile* efile - pointer to opened and valid .erad file instance
+* @param EradTraceHeader* theaders - array of n trace headers to write to file
+* @param const uint8_t* samples - trace data, samples of trace k right after those of trace k - 1
+* @param size_t n - number of traces
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_write_traces(LiberadFile* efile, EradTraceHeader* theaders, const uint8_t* samples, size_t n);
+
 /* Finishes writing .erad log file
 * @param  LiberadFile* efile - pointer to opened and valid .erad file instance
 */
 void liberad_finish_write(LiberadFile* efile);
 
+/* Sets up a write buffer for high-rate logging. While set, liberad_write_trace appends traces sequentially in call
+* order (no seek by trace_index) into the buffer, which is written out with a single write when full or when
+* flush_interval_ms have elapsed since the last flush.
+* @param  LiberadFile* efile - pointer to .erad file instance opened for writing
+* @param int64_t buffer_size - buffer size in bytes, 0 flushes and removes the buffer
+* @param int flush_interval_ms - maximum age of buffered data in milliseconds, 0 to flush on size only
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_set_write_buffer(LiberadFile* efile, int64_t buffer_size, int flush_interval_ms);
+
+/* Writes out buffered data and flushes the file stream. Use at durability points.
+* @param  LiberadFile* efile - pointer to .erad file instance opened for writing
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_flush(LiberadFile* efile);
+
+/* Writes the file as VER_2019_COMPRESSED: the same file header, with traces stored in compressed blocks of block_traces
+* (inter-trace delta + entropy coding) and a block offset index before the trace_count trailer. Reading a trace decodes
+* only its block. All traces must share one sample_size. Must be called before liberad_write_file_header.
+* @param  LiberadFile* efile - pointer to .erad file instance opened with LIBERAD_WRITE
+* @param liberad::CompressionMode mode - COMPRESSION_FAST (live logging), COMPRESSION_HIGH (archiving) or COMPRESSION_NONE
+* @param int block_traces - traces per block, e.g. LIBERAD_COMPRESSED_BLOCK_TRACES. Smaller blocks mean cheaper random access
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_set_compression(LiberadFile* efile, liberad::CompressionMode mode, int block_traces);
+
+/* Keeps a valid trace_count trailer on disk while logging. Every interval_ms (checked on each written trace) buffered
+* data is written out, followed by a trailer which the next trace overwrites, and the file is synced. A log cut off by
+* a crash is then readable up to the last checkpoint, and liberad_get_file_info recovers any later whole traces. With
+* direct writing the trailer is followed by block padding, so unfinished direct logs always take the recovery path.
+* @param  LiberadFile* efile - pointer to .erad file instance opened for writing
+* @param int interval_ms - checkpoint interval in milliseconds, 0 disables checkpoints
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_set_checkpoint_interval(LiberadFile* efile, int interval_ms);
+
+/* Writes a checkpoint now: buffered data, a trace_count trailer after it and a file sync
+* @param  LiberadFile* efile - pointer to .erad file instance opened for writing
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_checkpoint(LiberadFile* efile);
+
+/* Sets up direct writing for long surveys. Replaces the write buffer by an aligned buffer written with O_DIRECT, bypassing
+* the page cache, and reserves file extents with fallocate in preallocate_size steps. Traces are appended sequentially as
+* with liberad_set_write_buffer. liberad_finish_write trims the file to its true size before writing the trailer.
+* Outside Linux the buffer is written through the page cache and nothing is preallocated.
+* @param  LiberadFile* efile - pointer to .erad file instance opened with LIBERAD_WRITE or LIBERAD_APPEND, file header written
+* @param int64_t buffer_size - buffer size in bytes, e.g. LIBERAD_DIRECT_BUFFER_SIZE. 0 writes out and removes the buffer
+* @param int64_t preallocate_size - bytes reserved per fallocate call, e.g. LIBERAD_PREALLOCATE_SIZE. 0 disables preallocation
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_set_direct_write(LiberadFile* efile, int64_t buffer_size, int64_t preallocate_size);
+
+/* Writes out the direct write buffer, trims preallocated space and returns efile to regular writes. Called by
+* liberad_finish_write and liberad_close_file.
+* @param  LiberadFile* efile - pointer to .erad file instance
+*/
+void liberad_stop_direct_write(LiberadFile* efile);
+
+/* Starts asynchronous logging. liberad_write_trace_async copies traces into a lock-free single-producer/single-consumer
+* ring of preallocated slots and returns immediately; a writer thread drains the ring in batches through the write buffer.
+* The file must not be written with liberad_write_trace while async logging runs.
+* @param  LiberadFile* efile - pointer to .erad file instance opened for writing, file header written
+* @param int slot_count - number of queued traces, e.g. LIBERAD_ASYNC_SLOT_COUNT
+* @param int max_sample_size - largest sample_size accepted, in bytes
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_start_async_write(LiberadFile* efile, int slot_count, int max_sample_size);
+
+/* Queues a trace for the writer thread. Never blocks on I/O - safe to call from acquisition callbacks, from one thread only.
+* @param  LiberadFile* efile - pointer to .erad file instance with async logging started
+* @param const EradTraceHeader* theader - pointer to header to write to file, copied
+* @param const uint8_t* data - trace data, copied
+* @return -1 on ERROR (trace dropped: queue full or sample_size over max_sample_size), 0 on SUCCESS
+*/
+int liberad_write_trace_async(LiberadFile* efile, const EradTraceHeader* theader, const uint8_t* data);
+
+/* Writes out all queued traces and stops the writer thread. Called by liberad_finish_write and liberad_close_file.
+* @param  LiberadFile* efile - pointer to .erad file instance
+*/
+void liberad_stop_async_write(LiberadFile* efile);
+
+/* Reads queue depth, written, dropped (queue full) and overrun (trace larger than a slot) counters of efile's async writer.
+* Once the writer is stopped (liberad_finish_write) these are its final counters, all queued traces included
+* @param  LiberadFile* efile - pointer to .erad file instance
+* @param EradAsyncWriteStats* stats - pointer to stats struct to populate
+*/
+void liberad_get_async_write_stats(LiberadFile* efile, EradAsyncWriteStats* stats);
+
 
 /* ----------------------------------------------------------------------------------------------------------------- */
 
+/* Calculates the size in bytes of a single .erad trace on disk (trace header + data)
+* @param int sample_size - number of samples in a single trace. This function assumes uniform traces
+* @param int8_t file_version - version of recorded file
+*/
+long int liberad_get_trace_size(int sample_size, int8_t file_version);
+
 /* Calculates the byte index of an .erad trace header within a file
 * @param int64_t trace_index - trace index within file
 * @param int sample_size - number of samples in a single trace. This function assumes uniform traces
@@ -194,6 +478,81 @@ void liberad_close_file(LiberadFile* efile);
 */
 void liberad_export_to_segy(LiberadFile* source, const char* destination);
 
+/* Exports an erad file to a segy file on a pool of threads - each converts a chunk of traces and writes it at its
+* precomputed offset in destination
+* @param  LiberadFile* efile - pointer to .erad file instance for export
+* @param const char* destination - file location of new segy file
+* @param int thread_count - number of worker threads, 0 for one per hardware thread
+* @return int - exit code
+*/
+int liberad_export_to_segy(LiberadFile* source, const char* destination, int thread_count);
+
+/* Exports an erad file to a segy file with samples in the given format, written big-endian by vectorized kernels
+* @param  LiberadFile* efile - pointer to .erad file instance for export
+* @param const char* destination - file location of new segy file
+* @param int thread_count - number of worker threads, 0 for one per hardware thread
+* @param SegyBinaryHeader::DataSampleFormat format - BYTE_1_TWOS, BYTE_1_UNS, BYTE_2_TWOS, BYTE_4_IEEE or BYTE_4_IBM
+* @return int - exit code
+*/
+int liberad_export_to_segy(LiberadFile* source, const char* destination, int thread_count,
+                           SegyBinaryHeader::DataSampleFormat format);
+
+/* Sink receiving a streamed SEG-Y export in file order
+* @param const uint8_t* data - next bytes of the SEG-Y file, only valid during the call
+* @param int64_t size - number of bytes in data
+* @param void* user_data - pointer passed through from the caller
+* @return int - exit code, ERROR stops the export
+*/
+typedef int (*LiberadSegySink)(const uint8_t* data, int64_t size, void* user_data);
+
+/* Exports an erad file as a SEG-Y stream into a file descriptor. Writes strictly forward, so fd may be a pipe, socket
+* or stdout - the binary header trace count is taken from the .erad trailer up front.
+* @param  LiberadFile* efile - pointer to .erad file instance for export
+* @param int fd - file descriptor open for writing, left open
+* @param SegyBinaryHeader::DataSampleFormat format - BYTE_1_TWOS, BYTE_1_UNS, BYTE_2_TWOS, BYTE_4_IEEE or BYTE_4_IBM
+* @return int - exit code
+*/
+int liberad_export_to_segy_stream(LiberadFile* source, int fd, SegyBinaryHeader::DataSampleFormat format);
+
+/* Exports an erad file as a SEG-Y stream through sink, in file order and in chunks of several megabytes. The next
+* chunk is converted on a second thread while sink consumes the current one.
+* @param  LiberadFile* efile - pointer to .erad file instance for export
+* @param LiberadSegySink sink - function receiving the SEG-Y bytes in order
+* @param void* user_data - pointer passed to every sink invocation
+* @param SegyBinaryHeader::DataSampleFormat format - BYTE_1_TWOS, BYTE_1_UNS, BYTE_2_TWOS, BYTE_4_IEEE or BYTE_4_IBM
+* @return int - exit code
+*/
+int liberad_export_to_segy_stream(LiberadFile* source, LiberadSegySink sink, void* user_data,
+                                  SegyBinaryHeader::DataSampleFormat format);
+
+/* Imports a SEG-Y file into a new VER_2019 .erad file with the default amplitude scale, on one thread per hardware thread
+* @param const char* source - location of the SEG-Y file
+* @param const char* destination - file location of new .erad file
+* @return int - exit code
+*/
+int liberad_import_segy(const char* source, const char* destination);
+
+/* Imports a SEG-Y file into a new VER_2019 .erad file - the counterpart of liberad_export_to_segy. Samples in
+* BYTE_1_TWOS, BYTE_1_UNS, BYTE_2_TWOS, BYTE_4_IEEE or BYTE_4_IBM format are converted by vectorized kernels, chunks of
+* traces in parallel, each written at its precomputed offset. Shorter traces of variable length files are padded to the
+* longest one.
+* @param const char* source - location of the SEG-Y file
+* @param const char* destination - file location of new .erad file
+* @param float scale - .erad sample = SEG-Y sample * scale + 128, clamped to 0..255 (BYTE_1_UNS samples are copied).
+* 0 for the inverse of liberad_port_data_segy: 1 for 1 byte formats, 0.01 for the others
+* @param int thread_count - number of worker threads, 0 for one per hardware thread
+* @return int - exit code
+*/
+int liberad_import_segy(const char* source, const char* destination, float scale, int thread_count);
+
+/* Ports fields from a SEG-Y trace header back to an .erad trace header. Coordinates are scaled by scalarCoordinates and
+* stored as local or, for arc second and degree units, as geographic coordinates.
+* @param SegyTraceHeader* segy_t_header - pointer to source SEG-Y trace header
+* @param EradTraceHeader* t_header - pointer to EradTraceHeader struct to be populated
+* @param int64_t position - trace position in file, the trace_index when the sequence numbers are 0
+*/
+void liberad_port_segy_erad_trace_header(SegyTraceHeader* segy_t_header, EradTraceHeader* t_header, int64_t position);
+
 /* Produces a SEG-Y textual header as per the standard definition from fields of an .erad file header
 * @param EradFileHeader* f_header - pointer to .erad file header
 * @param char* txt_header - char buffer to hold f_header fields
@@ -201,7 +560,17 @@ void liberad_export_to_segy(LiberadFile* source, const char* destination);
 */
 void liberad_produce_segy_txt_header(EradFileHeader* f_header, char* txt_header, int txt_h_size);
 
+/* Produces a SEG-Y textual header for samples in format from fields of an .erad file header
+* @param EradFileHeader* f_header - pointer to .erad file header
+* @param char* txt_header - char buffer to hold f_header fields
+* @param txt_h_size - size of char buffer. As per the SEG-Y file definition this should be 3200 bytes
+* @param SegyBinaryHeader::DataSampleFormat format - sample format named in the header
+*/
+void liberad_produce_segy_txt_header(EradFileHeader* f_header, char* txt_header, int txt_h_size,
+                                     SegyBinaryHeader::DataSampleFormat format);
+
 /* Ports fields from an .erad trace header to a SEG-Y binary trace header as per the SEG-Y standard definition.
+* Local coordinates are stored in millimetres, with scalarCoordinates set accordingly.
 * @param EradTraceHeader* t_header - pointer to source .erad trace header
 * @param SegyTraceHeader* segy_t_header - pointer to SegyTraceHeader struct to be populated
 */
@@ -215,13 +584,26 @@ void liberad_port_erad_segy_bin_file_header(EradFileHeader* f_header, SegyBinary
 
 /* Ports trace data acquired from Oerad hardware and logged to an .erad file (unsigned byte) to a signed short.
 * Technically the latest SEG-Y revision allows for uint8_t data but not every SEG-Y viewing package
-* has implemented the latest version of the standard.
+* has implemented the latest version of the standard. Vectorized (SSE2/AVX2/AVX-512) where the CPU supports it, the
+* kernel is picked once at runtime.
 * @param uint8_t* data_source - pointer to raw data source buffer
-* @param int16_t* data_dest - pointer to segy raw data destination buffer
+* @param int16_t* data_dest - pointer to segy raw data destination buffer, native byte order
 * @param int data_length - number of samples in trace.
 */
 void liberad_port_data_segy(uint8_t* data_source, int16_t* data_dest, int data_length);
 
+/* Ports .erad trace data to SEG-Y samples of format, big-endian as stored in a SEG-Y file. BYTE_1_UNS keeps the raw
+* bytes, the signed formats hold x - 128 and, beyond one byte, are scaled by 100 like liberad_port_data_segy. Vectorized
+* (AVX2) where the CPU supports it.
+* @param const uint8_t* data_source - pointer to raw data source buffer
+* @param uint8_t* data_dest - destination buffer of data_length * sample size bytes
+* @param int data_length - number of samples in trace.
+* @param SegyBinaryHeader::DataSampleFormat format - BYTE_1_TWOS, BYTE_1_UNS, BYTE_2_TWOS, BYTE_4_IEEE or BYTE_4_IBM
+* @return int - exit code
+*/
+int liberad_port_data_segy(const uint8_t* data_source, uint8_t* data_dest, int data_length,
+                           SegyBinaryHeader::DataSampleFormat format);
+
 /* ---------------------------------------------------------- */
 
 /* Open a .sgy file for writing
@@ -235,31 +617,96 @@ int liberad_open_segy_file_w(SegyFile* sfile, const char* filename);
 */
 int liberad_open_segy_file_w(SegyFile* sfile);
 
+/* Replaces the write buffer traces are appended through - liberad_open_segy_file_w sets one of SEGY_WRITE_BUFFER_SIZE
+* bytes. Buffered traces are written out first.
+* @param SegyFile* sfile - pointer to opened SegyFile .sgy instance
+* @param int64_t buffer_size - buffer size in bytes, 0 writes every trace straight to the stream
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_set_segy_write_buffer(SegyFile* sfile, int64_t buffer_size);
+
+/* Writes out buffered traces and flushes the file stream. Use at durability points.
+* @param SegyFile* sfile - pointer to opened SegyFile .sgy instance
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_flush_segy(SegyFile* sfile);
+
 /* Writes a 3200-byte segy txt_header to file
 * @param SegyFile* sfile - pointer to SegyFile .sgy instance
 * char* txt_header - pointer to char array holding the segy txt header
 */
 void liberad_write_segy_txt_h(SegyFile* sfile, char* txt_header);
 
-/* Writes a segy binary header to file
+/* Writes a segy binary header to file, packed big-endian as per the SEG-Y standard. Its numOfTracesInFile is
+* replaced by the number of traces written when the file is closed.
 * @param SegyFile* sfile - pointer to SegyFile .sgy instance
 * SegyBinaryHeader* b_header - pointer to segy binary header to write to file
 */
 void liberad_write_segy_bin_h(SegyFile* sfile, SegyBinaryHeader* b_header);
 
-/* Writes segy binary trace header and raw trace data to file
+/* Appends a segy binary trace header, packed big-endian as per the SEG-Y standard, and raw trace data after the last
+* trace written. Traces go through the write buffer and sfile->trace_count counts them.
 * @param SegyFile* sfile - pointer to SegyFile .sgy instance
 * @param SegyTraceHeader* t_header - pointer to segy trace header to write to file
-* @param void* data - raw trace data to write to file
-* @param int data_size - number of samples in current trace
+* @param const void* data - raw trace data to write to file
+* @param int data_size - size of trace data in bytes
 */
-void liberad_write_segy_trace(SegyFile* sfile, SegyTraceHeader* t_header, void* data, int data_size);
+void liberad_write_segy_trace(SegyFile* sfile, SegyTraceHeader* t_header, const void* data, int data_size);
 
 
-/* Close the SegyFile stream instance
+/* Close the SegyFile stream instance. Writes out buffered traces and the trace count into the binary header.
 * @param SegyFile* sfile - pointer to SegyFile .sgy instance
 */
 void liberad_close_segy_file_w(SegyFile* sfile);
 
+/* ---------------------------------------------------------- */
+
+/* Open a .sgy file for reading. The file is memory-mapped, its binary header decoded into sfile->bin_header and its
+* traces indexed - fixed or variable length, after any extended textual headers and before any trailer stanzas.
+* Big-endian as per the standard, little-endian files are recognised by their integer constant.
+* @param SegyFile* sfile - pointer to SegyFile .sgy instance
+* @param const char* filename - location of file
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_open_segy_file_r(SegyFile* sfile, const char* filename);
+
+/* Open a .sgy file for reading. Assumes filename field has been set
+* @param SegyFile* sfile - pointer to SegyFile .sgy instance
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_open_segy_file_r(SegyFile* sfile);
+
+/* Copies the 3200-byte textual header, translated to ASCII when stored in EBCDIC
+* @param SegyFile* sfile - pointer to SegyFile .sgy instance opened for reading
+* @param char* txt_header - buffer of at least SEGY_TXT_HEADER_SIZE chars, not null terminated
+*/
+void liberad_get_segy_txt_header(SegyFile* sfile, char* txt_header);
+
+/* Points a view at a trace of the mapped file without copying it
+* @param SegyFile* sfile - pointer to SegyFile .sgy instance opened for reading
+* @param int64_t trace_index - trace index in file, from 0 to sfile->trace_count - 1
+* @param SegyTraceView* view - view to set, valid until the file is closed
+* @return -1 on ERROR, 0 on SUCCESS
+*/
+int liberad_get_segy_trace(SegyFile* sfile, int64_t trace_index, SegyTraceView* view);
+
+/* Decodes the trace header of a trace view
+* @param const SegyTraceView* view - view set by liberad_get_segy_trace
+* @param SegyTraceHeader* t_header - trace header to populate
+*/
+void liberad_get_segy_trace_header(const SegyTraceView* view, SegyTraceHeader* t_header);
+
+/* Decodes the samples of a trace view to floats, whatever the file's sample format
+* @param const SegyTraceView* view - view set by liberad_get_segy_trace
+* @param float* data - buffer of at least view->sample_count floats
+* @return -1 on ERROR (unsupported sample format), 0 on SUCCESS
+*/
+int liberad_get_segy_trace_data(const SegyTraceView* view, float* data);
+
+/* Close a SegyFile opened for reading and unmap it
+* @param SegyFile* sfile - pointer to SegyFile .sgy instance
+*/
+void liberad_close_segy_file_r(SegyFile* sfile);
+
 
 #endif
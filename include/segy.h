@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 #include <sstream>
 #include <iomanip>
 
@@ -10,6 +11,8 @@
 #define SEGY_BIN_HEADER_SIZE 400
 #define SEGY_TRACE_HEADER_SIZE 240
 
+#define SEGY_WRITE_BUFFER_SIZE (4 * 1024 * 1024)
+
 /*
  * BIG ENDIAN
  * NO FLOATS IN HEADERS
@@ -218,6 +221,39 @@ struct SegyFile {
   const char* filename = nullptr;
   bool is_open = false;
 
+  // traces are appended through the write buffer - see liberad_set_segy_write_buffer
+  uint8_t* write_buffer = nullptr;
+  int64_t write_buffer_size = 0;
+  int64_t write_buffer_used = 0;
+  // file offset the buffered traces are written out at
+  int64_t trace_offset = SEGY_TXT_HEADER_SIZE + SEGY_BIN_HEADER_SIZE;
+  int64_t trace_count = 0;
+  // numOfTracesInFile is patched with trace_count on close once a binary header is written
+  bool has_bin_header = false;
+
+  // read only - whole file mapped read-only, see liberad_open_segy_file_r
+  const uint8_t* map = nullptr;
+  int64_t map_size = 0;
+  // file byte order differs from the system's
+  bool swap = false;
+  SegyBinaryHeader bin_header;
+  // offset of every trace header in the file
+  std::vector<int64_t> trace_offsets;
+
+};
+
+
+/* Zero-copy view of one trace of a mapped SegyFile - valid until the file is closed. Fields and samples are decoded on
+ * access, see liberad_get_segy_trace_header and liberad_get_segy_trace_data.
+ */
+struct SegyTraceView {
+
+  const uint8_t* header = nullptr;
+  const uint8_t* data = nullptr;
+  int32_t sample_count = 0;
+  int16_t format_code = 0;
+  bool swap = false;
+
 };
 
 
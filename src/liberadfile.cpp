@@ -1,10 +1,65 @@
 #include "../include/liberadfile.h"
 #include <cstring>
+#include <algorithm>
 #include <math.h>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LIBERAD_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// O_DIRECT, fallocate and fdatasync - elsewhere direct writing goes through the page cache without preallocation
+#if defined(__linux__)
+#define LIBERAD_HAVE_DIRECT_IO
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define LIBERAD_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
 
 using namespace std;
 using namespace liberad;
 
+// upper bound in bytes of a single read issued by the bulk readers
+#define LIBERAD_BULK_READ_SIZE (4 * 1024 * 1024)
+#define LIBERAD_SEGY_COORDINATE_SCALE 1000
+// number of reads submitted together by liberad_get_traces
+#define LIBERAD_BATCH_QUEUE_DEPTH 128
+// traces per vectored write of liberad_write_traces - two iovecs each, kept under IOV_MAX
+#define LIBERAD_WRITEV_TRACES 512
+// write buffer set up by liberad_start_async_write on instances without one
+#define LIBERAD_ASYNC_WRITE_BUFFER_SIZE (1024 * 1024)
+// writer thread back-off while the async queue is empty
+#define LIBERAD_ASYNC_IDLE_US 500
+// compressed block header - payload size, trace count, sample size, mode
+#define LIBERAD_BLOCK_HEADER_SIZE 12
+// compressed file footer after the block offsets - block_traces, padding, block count
+#define LIBERAD_BLOCK_FOOTER_SIZE 16
+// residuals sharing one Rice parameter in COMPRESSION_FAST blocks
+#define LIBERAD_RICE_GROUP 64
+// trailing trace headers validated when recovering the trace count of an unfinished log
+#define LIBERAD_RECOVERY_CHECK 4
+// buffer, offset and length alignment of O_DIRECT writes
+#define LIBERAD_DIRECT_ALIGNMENT 4096
+
 
 /* ----------------------------Forward declaration of helper functs------------------------------------------------ */
 
@@ -14,16 +69,109 @@ EndiannessMarker liberad_get_system_endianness();
 
 std::string liberad_get_stream_mode(LiberadFile::Mode mode);
 
-void liberad_shift_file_header_endianness(EradFileHeader* f_header);
-void liberad_shift_trace_header_ver1_endianness(EradTraceHeader_VER_1* t_header);
-void liberad_shift_trace_header_ver2_endianness(EradTraceHeader* t_header);
-
-void read_th_v1(FILE* stream, EradTraceHeader_VER_1* th);
-void read_th_v2(FILE* stream, EradTraceHeader* th);
-void read_fh(FILE* stream, EradFileHeader* fh);
-
-void write_th_v2(FILE* stream, EradTraceHeader* th);
-void write_fh(FILE* stream, EradFileHeader* fh);
+bool liberad_check_trace_range(LiberadFile* efile, int64_t index_start, int64_t index_end);
+int64_t liberad_get_span_trace_count(long int trace_size, int64_t trace_total);
+const uint8_t* liberad_read_span(LiberadFile* efile, long int offset, long int size, uint8_t* buffer);
+int liberad_read_at(LiberadFile* efile, long int offset, uint8_t* buffer, long int size);
+int liberad_read_trace(LiberadFile* efile, int64_t trace_index, uint8_t* th_raw, uint8_t* data);
+int liberad_pread(int fd, uint8_t* buffer, long int size, long int offset);
+template<typename Visitor>
+void liberad_for_each_span(LiberadFile* efile, int64_t index_start, int64_t index_end, Visitor visit);
+
+void liberad_resize_trace_index(EradTraceIndex* index, int64_t trace_count);
+int liberad_load_folds(LiberadFile* efile);
+
+bool liberad_cache_read(LiberadFile* efile, int64_t trace_index, uint8_t* th_raw, uint8_t* data);
+bool liberad_prefetch_read(LiberadPrefetcher* prefetcher, int64_t trace_index, uint8_t* th_raw, uint8_t* data);
+void liberad_prefetch_worker(LiberadPrefetcher* prefetcher);
+
+int liberad_get_traces_uring(LiberadFile* efile, const int64_t* indices, size_t n, struct iovec* iov, bool* done);
+
+int liberad_map_file(LiberadFile* efile);
+void liberad_unmap_file(LiberadFile* efile);
+int liberad_get_madvise_flag(LiberadFile::AccessHint hint);
+
+template<typename T>
+T decode_field(const uint8_t* buffer, int offset, bool swap);
+void decode_th_v1(const uint8_t* buffer, EradTraceHeader_VER_1* th, bool swap);
+void decode_th_v2(const uint8_t* buffer, EradTraceHeader* th, bool swap);
+void decode_fh(const uint8_t* buffer, EradFileHeader* fh, bool swap);
+
+template<typename T>
+void encode_field(uint8_t* buffer, int offset, T value, bool swap);
+void encode_th_v2(const EradTraceHeader* th, uint8_t* buffer, bool swap);
+void encode_fh(const EradFileHeader* fh, uint8_t* buffer, bool swap);
+void encode_segy_bh(const SegyBinaryHeader* bh, uint8_t* buffer);
+void encode_segy_th(const SegyTraceHeader* th, uint8_t* buffer);
+void patch_segy_th(const SegyTraceHeader* th, uint8_t* buffer);
+void decode_segy_bh(const uint8_t* buffer, SegyBinaryHeader* bh, bool swap);
+void decode_segy_th(const uint8_t* buffer, SegyTraceHeader* th, bool swap);
+int liberad_index_segy_traces(SegyFile* sfile);
+int liberad_get_segy_sample_size(int16_t format);
+int64_t liberad_get_segy_trace_samples(SegyFile* sfile, const uint8_t* t_header);
+float liberad_ibm_to_float(uint32_t ibm);
+
+typedef void (*LiberadImportKernel)(const uint8_t* source, uint8_t* dest, int count, int16_t format, float scale, bool swap);
+LiberadImportKernel liberad_select_import_kernel();
+void liberad_import_samples_scalar(const uint8_t* source, uint8_t* dest, int count, int16_t format, float scale, bool swap);
+#ifdef LIBERAD_HAVE_X86_SIMD
+void liberad_import_samples_avx2(const uint8_t* source, uint8_t* dest, int count, int16_t format, float scale, bool swap);
+#endif
+void liberad_get_date_of_day(int year, int day_of_year, int16_t* month, int16_t* day);
+int liberad_get_day_of_year(int year, int month, int day);
+
+void liberad_write_bytes(LiberadFile* efile, const uint8_t* data, int64_t size);
+int liberad_writev(int fd, struct iovec* iov, int iov_count, long int offset);
+int liberad_sync_data(int fd);
+int liberad_resume_append(LiberadFile* efile);
+long int liberad_get_write_offset(LiberadFile* efile, const EradTraceHeader* t_header);
+int64_t liberad_count_traces(LiberadFile* efile, int sample_size, bool swap, bool* finished);
+bool liberad_check_trace_header(LiberadFile* efile, int64_t trace_index, int sample_size, bool swap);
+int64_t liberad_get_time_ms();
+void liberad_async_write_worker(LiberadAsyncWriter* writer);
+int liberad_direct_write_out(LiberadFile* efile, bool pad);
+
+typedef void (*LiberadPortKernel)(const uint8_t* data_source, int16_t* data_dest, int data_length);
+LiberadPortKernel liberad_select_port_kernel();
+void liberad_port_data_segy_scalar(const uint8_t* data_source, int16_t* data_dest, int data_length);
+#ifdef LIBERAD_HAVE_X86_SIMD
+void liberad_port_data_segy_sse2(const uint8_t* data_source, int16_t* data_dest, int data_length);
+void liberad_port_data_segy_avx2(const uint8_t* data_source, int16_t* data_dest, int data_length);
+void liberad_port_data_segy_avx512(const uint8_t* data_source, int16_t* data_dest, int data_length);
+#endif
+
+typedef void (*LiberadSegyKernel)(const uint8_t* data_source, uint8_t* data_dest, int data_length);
+LiberadSegyKernel liberad_select_segy_kernel(int16_t format);
+void liberad_port_segy_1_uns(const uint8_t* data_source, uint8_t* data_dest, int data_length);
+void liberad_port_segy_1_twos_scalar(const uint8_t* data_source, uint8_t* data_dest, int data_length);
+void liberad_port_segy_2_twos_scalar(const uint8_t* data_source, uint8_t* data_dest, int data_length);
+void liberad_port_segy_4_ieee_scalar(const uint8_t* data_source, uint8_t* data_dest, int data_length);
+void liberad_port_segy_4_ibm_scalar(const uint8_t* data_source, uint8_t* data_dest, int data_length);
+#ifdef LIBERAD_HAVE_X86_SIMD
+void liberad_port_segy_1_twos_avx2(const uint8_t* data_source, uint8_t* data_dest, int data_length);
+void liberad_port_segy_2_twos_avx2(const uint8_t* data_source, uint8_t* data_dest, int data_length);
+void liberad_port_segy_4_ieee_avx2(const uint8_t* data_source, uint8_t* data_dest, int data_length);
+void liberad_port_segy_4_ibm_avx2(const uint8_t* data_source, uint8_t* data_dest, int data_length);
+#endif
+uint32_t liberad_float_to_ibm(float value);
+LiberadSegyKernel liberad_prepare_segy_export(LiberadFile* source, SegyBinaryHeader::DataSampleFormat format,
+                                              uint8_t* file_headers, uint8_t* th_template);
+int64_t liberad_get_segy_chunk_traces(LiberadFile* source, long int segy_trace_size);
+int liberad_convert_segy_chunk(LiberadFile* source, int64_t first, int64_t count, const uint8_t* th_template,
+                               LiberadSegyKernel kernel, long int segy_trace_size, uint8_t* input, uint8_t* output);
+int liberad_write_segy_fd(const uint8_t* data, int64_t size, void* user_data);
+
+int liberad_load_blocks(LiberadFile* efile);
+void liberad_free_blocks(LiberadFile* efile);
+void liberad_free_uring(LiberadFile* efile);
+int liberad_read_trace_span(LiberadFile* efile, int64_t first, int64_t count, uint8_t* buffer);
+int64_t liberad_read_block(LiberadFile* efile, int64_t block, int64_t capacity, std::vector<uint8_t>& payload, uint8_t* traces);
+const uint8_t* liberad_decode_block_at(LiberadFile* efile, int64_t block);
+int liberad_append_block_trace(LiberadFile* efile, const uint8_t* th_raw, const uint8_t* data, int sample_size);
+int liberad_write_block(LiberadFile* efile);
+void liberad_finish_blocks(LiberadFile* efile);
+void liberad_encode_block(const uint8_t* traces, int64_t count, long int trace_size, CompressionMode mode, std::vector<uint8_t>* out);
+int liberad_decode_block(const uint8_t* payload, size_t size, int64_t count, long int trace_size, CompressionMode mode, uint8_t* traces);
 
 
 /* ----------------------------LiberadFile constructors------------------------------------------------ */
@@ -91,12 +239,30 @@ int liberad_open_file(LiberadFile* efile){
 
   string stream_type = liberad_get_stream_mode(efile->mode);
   efile->stream = fopen(efile->filename, stream_type.c_str());
+  if (efile->stream == NULL && efile->mode == LiberadFile::LIBERAD_APPEND && errno == ENOENT){
+    efile->stream = fopen(efile->filename, "w+b");
+  }
 
   if (efile->stream == NULL){
     cout << "could not open file " << endl;
     return ERROR;
   }
+
+  efile->fd = fileno(efile->stream);
+
+  if (efile->mode == LiberadFile::LIBERAD_READ_MMAP && liberad_map_file(efile) != SUCCESS){
+    cout << "could not map file " << endl;
+    fclose(efile->stream);
+    efile->stream = nullptr;
+    return ERROR;
+  }
+
   efile->is_open = true;
+
+  if (efile->mode == LiberadFile::LIBERAD_APPEND && liberad_resume_append(efile) != SUCCESS){
+    liberad_close_file(efile);
+    return ERROR;
+  }
   return SUCCESS;
 }
 
@@ -104,9 +270,78 @@ int liberad_open_file(LiberadFile* efile){
 */
 void liberad_close_file(LiberadFile* efile){
   if (efile->is_open){
+    liberad_stop_async_write(efile);
+    liberad_set_write_buffer(efile, 0, 0);
+    liberad_set_trace_cache(efile, 0, 0);
+    liberad_disable_prefetch(efile);
+    liberad_unmap_file(efile);
+    liberad_free_blocks(efile);
+    liberad_free_uring(efile);
     fclose(efile->stream);
     efile->is_open = false;
     efile->stream = nullptr;
+    efile->fd = -1;
+    efile->folds.clear();
+    efile->folds_loaded = false;
+  }
+}
+
+
+/* Private funct. Prepares a LIBERAD_APPEND instance to continue an existing log: restores trace_count from the trailer,
+* or by recovery for a log that was never finished, and positions the stream over the trailer so that the next trace
+* overwrites it. Data after the last whole trace of an unfinished log is cut off. Empty files are left for a new file header.
+*/
+int liberad_resume_append(LiberadFile* efile){
+  liberad_get_file_size(efile);
+  if (efile->file_size == 0){
+    efile->trace_count = 0;
+    return SUCCESS;
+  }
+
+  uint8_t buffer[FH_SIZE];
+  int8_t magic[8] = {0x00, 0x45, 0x41, 0x53, 0x59, 0x52, 0x41, 0x44};
+  if (efile->file_size < FH_SIZE || liberad_read_at(efile, 0, buffer, FH_SIZE) != SUCCESS || memcmp(buffer, magic, 8) != 0){
+    cout << "Header bytes do not match pattern" << endl;
+    return ERROR;
+  }
+  if (static_cast<int8_t>(buffer[8]) != VER_2019){
+    cout << "only VER_2019 files can be appended to" << endl;
+    return ERROR;
+  }
+
+  efile->file_ver = VER_2019;
+  efile->endianness = liberad_get_file_endianness(reinterpret_cast<int8_t*>(buffer + 9));
+  bool swap = efile->endianness != system_endianness;
+  int sample_size = decode_field<int16_t>(buffer, 36, swap);
+
+  bool finished = false;
+  int64_t trace_count = liberad_count_traces(efile, sample_size, swap, &finished);
+  if (finished){
+    // continue after every trace slot, not just the trailer count, so no written trace is overwritten
+    trace_count = (efile->file_size - FH_SIZE) / liberad_get_trace_size(sample_size, efile->file_ver);
+  }
+  long int data_end = liberad_get_trace_header_index_at(trace_count, sample_size, efile->file_ver);
+
+  if (!finished && efile->file_size != data_end){
+    cout << "dropping partially written data after trace " << trace_count << endl;
+    if (ftruncate(efile->fd, data_end) != 0){
+      return ERROR;
+    }
+  }
+
+  efile->trace_count = trace_count;
+  fseek(efile->stream, data_end, SEEK_SET);
+  return SUCCESS;
+}
+
+
+/* Sets the kernel paging hint (madvise) of a LIBERAD_READ_MMAP instance. May be called before opening the file, in which
+* case the hint is applied once the file gets mapped.
+*/
+void liberad_set_access_hint(LiberadFile* efile, LiberadFile::AccessHint hint){
+  efile->access_hint = hint;
+  if (efile->map != nullptr){
+    madvise(efile->map, efile->map_size, liberad_get_madvise_flag(hint));
   }
 }
 
@@ -154,6 +389,19 @@ void liberad_get_file_info(LiberadFile* efile, EradFileHeader* f_header){
 
   liberad_get_trace_count(efile);
   liberad_get_file_size(efile);
+
+  if (efile->file_ver == VER_2019_COMPRESSED){
+    liberad_load_blocks(efile);
+    return;
+  }
+
+  bool finished = false;
+  int64_t trace_count = liberad_count_traces(efile, f_header->sample_size, efile->endianness != system_endianness, &finished);
+  if (!finished){
+    cout << "trace count trailer missing, recovered " << trace_count << " traces" << endl;
+    efile->trace_count = trace_count;
+    efile->is_recovered = true;
+  }
 }
 
 
@@ -166,9 +414,10 @@ void liberad_get_trace_at(LiberadFile* efile, int64_t trace_index, EradTraceHead
     return;
   }
 
-  long int index = liberad_get_trace_header_index_at(trace_index, efile->f_header->sample_size, efile->file_ver);
-  liberad_read_trace_header(efile, index, t_header);
-  fread(data, efile->f_header->sample_size, 1, efile->stream);
+  uint8_t raw[TH_SIZE_VER_2];
+  if (liberad_read_trace(efile, trace_index, raw, data) == SUCCESS){
+    liberad_decode_trace_header(efile, raw, t_header);
+  }
 
 }
 
@@ -182,8 +431,10 @@ void liberad_get_trace_header_at(LiberadFile* efile, int64_t trace_index, EradTr
     return;
   }
 
-  long int index = liberad_get_trace_header_index_at(trace_index, efile->f_header->sample_size, efile->file_ver);
-  liberad_read_trace_header(efile, index, t_header);
+  uint8_t raw[TH_SIZE_VER_2];
+  if (liberad_read_trace(efile, trace_index, raw, nullptr) == SUCCESS){
+    liberad_decode_trace_header(efile, raw, t_header);
+  }
 
 }
 
@@ -196,9 +447,42 @@ void liberad_get_trace_data_at(LiberadFile* efile, int64_t trace_index, uint8_t*
     return;
   }
 
-  long int index = liberad_get_trace_data_index_at(trace_index, efile->f_header->sample_size, efile->file_ver);
-  fseek(efile->stream, index, SEEK_SET);
-  fread(data, efile->f_header->sample_size, 1, efile->stream);
+  liberad_read_trace(efile, trace_index, nullptr, data);
+
+}
+
+
+/* Returns a pointer to the raw samples of the trace at trace_index straight inside the mapped file. The pointer stays
+* valid until the file is closed. Returns nullptr if the file is not mapped or trace_index is out of bounds.
+*/
+const uint8_t* liberad_get_trace_data_view_at(LiberadFile* efile, int64_t trace_index){
+  if (!efile->is_valid || efile->map == nullptr || efile->blocks != nullptr){
+    cout << "File not compatible, compressed or not mapped"<< endl;
+    return nullptr;
+  }
+
+  int sample_size = efile->f_header->sample_size;
+  long int index = liberad_get_trace_data_index_at(trace_index, sample_size, efile->file_ver);
+  if (trace_index < 0 || index + sample_size > efile->map_size){
+    cout << "trace index out of bounds"<< endl;
+    return nullptr;
+  }
+  return efile->map + index;
+
+}
+
+
+/* Gets trace header data of the trace at trace_index and returns a pointer to its raw samples inside the mapped file.
+*/
+const uint8_t* liberad_get_trace_view_at(LiberadFile* efile, int64_t trace_index, EradTraceHeader* t_header){
+  const uint8_t* view = liberad_get_trace_data_view_at(efile, trace_index);
+  if (view == nullptr){
+    return nullptr;
+  }
+
+  long int index = liberad_get_trace_header_index_at(trace_index, efile->f_header->sample_size, efile->file_ver);
+  liberad_read_trace_header(efile, index, t_header);
+  return view;
 
 }
 
@@ -220,6 +504,72 @@ void liberad_get_trace_count(LiberadFile* efile){
 }
 
 
+/* Private funct. Returns the number of traces in efile (file_size and file_ver set). finished is set when the file ends
+* with a trace_count trailer that fits its size - files numbering traces from 1 hold one trace slot more than their
+* trailer counts. Otherwise the count is derived from the file size and the trace stride, stepping back over a
+* partially written tail until the last LIBERAD_RECOVERY_CHECK trace headers decode as valid.
+*/
+int64_t liberad_count_traces(LiberadFile* efile, int sample_size, bool swap, bool* finished){
+  *finished = false;
+  long int trace_size = liberad_get_trace_size(sample_size, efile->file_ver);
+  int64_t body = efile->file_size - FH_SIZE;
+  if (body <= 0 || sample_size <= 0){
+    return 0;
+  }
+
+  int64_t trace_count = body / trace_size;
+  if (body % trace_size == static_cast<int64_t>(sizeof(trace_count))){
+    uint8_t trailer[sizeof(trace_count)];
+    if (liberad_read_at(efile, efile->file_size - sizeof(trailer), trailer, sizeof(trailer)) == SUCCESS){
+      int64_t trailer_count = decode_field<int64_t>(trailer, 0, swap);
+      if (trailer_count >= 0 && trailer_count <= trace_count){
+        *finished = true;
+        return trailer_count;
+      }
+    }
+  }
+
+  int valid = 0;
+  for (int64_t index = trace_count - 1; index >= 0 && valid < LIBERAD_RECOVERY_CHECK; index--){
+    if (liberad_check_trace_header(efile, index, sample_size, swap)){
+      valid++;
+    } else {
+      trace_count = index;
+      valid = 0;
+    }
+  }
+  return trace_count;
+}
+
+
+/* Private funct. Returns true if the on-disk header of the trace at trace_index decodes to plausible values
+*/
+bool liberad_check_trace_header(LiberadFile* efile, int64_t trace_index, int sample_size, bool swap){
+  uint8_t raw[TH_SIZE_VER_2];
+  long int th_size = liberad_get_trace_size(sample_size, efile->file_ver) - sample_size;
+  long int index = liberad_get_trace_header_index_at(trace_index, sample_size, efile->file_ver);
+  if (liberad_read_at(efile, index, raw, th_size) != SUCCESS){
+    return false;
+  }
+
+  EradTraceHeader th;
+  if (efile->file_ver == VER_2018){
+    EradTraceHeader_VER_1 th_v1;
+    decode_th_v1(raw, &th_v1, swap);
+    th.sample_size = th_v1.sample_size;
+    th.hour = th_v1.hour;
+    th.minute = th_v1.minute;
+    th.second = th_v1.second;
+    th.millisecond = th_v1.millisecond;
+  } else {
+    decode_th_v2(raw, &th, swap);
+  }
+
+  return th.sample_size == sample_size && th.hour >= 0 && th.hour < 24 && th.minute >= 0 && th.minute < 60 &&
+         th.second >= 0 && th.second < 60 && th.millisecond >= 0 && th.millisecond < 1000;
+}
+
+
 /* Gets the file size of an opened LiberadFile instance
 */
 void liberad_get_file_size(LiberadFile* efile){
@@ -236,298 +586,2625 @@ void liberad_get_file_size(LiberadFile* efile){
 }
 
 
-/* ----------------------------------Bulk data extraction - not tested--------------------------------------------------- */
-//TODO
+/* ----------------------------------Bulk data extraction--------------------------------------------------- */
+
+/* Reads raw trace data of traces index_start to index_end (inclusive) into data. The whole span is read with a few large
+* reads of up to LIBERAD_BULK_READ_SIZE bytes and the samples are gathered out of it, skipping the interleaved headers.
+*/
 void liberad_get_trace_data(LiberadFile* efile, int64_t index_start, int64_t index_end, uint8_t* data){
   if (!efile->is_valid){
     cout << "File not compatible"<< endl;
     return;
   }
-  long int index;
+  if (!liberad_check_trace_range(efile, index_start, index_end)){
+    return;
+  }
+
   int sample_size = efile->f_header->sample_size;
+  long int trace_size = liberad_get_trace_size(sample_size, efile->file_ver);
+  long int th_size = trace_size - sample_size;
 
-  for (int i = index_start, j=0; i <= index_end; i++, j++){
-    index = liberad_get_trace_data_index_at(index_start, sample_size, efile->file_ver);
-    fseek(efile->stream, index, SEEK_SET);
-    fread(&data[j*sample_size], sample_size, 1, efile->stream);
-  }
+  liberad_for_each_span(efile, index_start, index_end, [&](const uint8_t* span, int64_t first, int64_t count){
+    uint8_t* dest = data + (first - index_start) * sample_size;
+    for (int64_t i = 0; i < count; i++){
+      memcpy(dest + i * sample_size, span + i * trace_size + th_size, sample_size);
+    }
+  });
 
 }
 
 
-// TODO
+/* Writes raw trace data of traces index_start to index_end (inclusive) to out_stream. Samples are gathered per span and
+* written with one out_stream->write per span.
+*/
 void liberad_get_trace_data(LiberadFile* efile, int64_t index_start, int64_t index_end, ostream* out_stream){
   if (!efile->is_valid){
     cout << "File not compatible"<< endl;
     return;
   }
+  if (!liberad_check_trace_range(efile, index_start, index_end)){
+    return;
+  }
 
-  long int index;
   int sample_size = efile->f_header->sample_size;
-  uint8_t* data_buffer = new uint8_t[sample_size];
-
-
-  for (int i = index_start; i <= index_end; i++){
-    index = liberad_get_trace_data_index_at(i, sample_size, efile->file_ver);
-    fseek(efile->stream, index, SEEK_SET);
-    fread(data_buffer, sample_size, 1, efile->stream);
-    // out_stream->write(data_buffer, sample_size);
-  }
+  long int trace_size = liberad_get_trace_size(sample_size, efile->file_ver);
+  long int th_size = trace_size - sample_size;
+  int64_t span_traces = liberad_get_span_trace_count(trace_size, index_end - index_start + 1);
+  uint8_t* data_buffer = new uint8_t[span_traces * sample_size];
+
+  liberad_for_each_span(efile, index_start, index_end, [&](const uint8_t* span, int64_t, int64_t count){
+    for (int64_t i = 0; i < count; i++){
+      memcpy(data_buffer + i * sample_size, span + i * trace_size + th_size, sample_size);
+    }
+    out_stream->write(reinterpret_cast<const char*>(data_buffer), count * sample_size);
+  });
 
   delete[] data_buffer;
 }
 
-/* -------------------------------------Logging data ---------------------------------------------------- */
-
 
-/* Writes a file header to an opened LiberadFile instance. Presumes that relevant header fields are preset.
+/* Streams traces index_start to index_end (inclusive) through callback. Spans of whole traces are read as in the bulk
+* readers and callback gets each trace's decoded header and a pointer to its samples inside the span. Both pointers are
+* only valid for the duration of the call.
 */
-void liberad_write_file_header(LiberadFile* efile, EradFileHeader* f_header){
-  if (!efile->is_open){
-    cout << "File not opened"<< endl;
+void liberad_get_trace_data(LiberadFile* efile, int64_t index_start, int64_t index_end, LiberadTraceCallback callback, void* user_data){
+  if (!efile->is_valid){
+    cout << "File not compatible"<< endl;
+    return;
+  }
+  if (!liberad_check_trace_range(efile, index_start, index_end)){
     return;
   }
-  int8_t magic[8] = {0x00, 0x45, 0x41, 0x53, 0x59, 0x52, 0x41, 0x44};
 
-  memcpy(f_header->magic_num, magic, 8);
-  f_header->file_version = VER_2019;
-  if (system_endianness == BIG_END){
-    f_header->endianness_marker[0] = 0xFE;
-    f_header->endianness_marker[1] = 0xFF;
+  int sample_size = efile->f_header->sample_size;
+  long int trace_size = liberad_get_trace_size(sample_size, efile->file_ver);
+  long int th_size = trace_size - sample_size;
+  EradTraceHeader t_header;
 
-  } else {
-    f_header->endianness_marker[0] = 0xFF;
-    f_header->endianness_marker[1] = 0xFE;
-  }
+  liberad_for_each_span(efile, index_start, index_end, [&](const uint8_t* span, int64_t, int64_t count){
+    for (int64_t i = 0; i < count; i++){
+      const uint8_t* trace = span + i * trace_size;
+      liberad_decode_trace_header(efile, trace, &t_header);
+      callback(&t_header, trace + th_size, user_data);
+    }
+  });
 
-  write_fh(efile->stream, f_header);
-  // fwrite(f_header, FH_SIZE, 1, efile->stream);
-  // fflush(efile->stream);
 }
 
 
-/* Writes a single trace's header and data samples to an opened LiberadFile instance. Presumes that relevant header fields are preset.
+/* Private funct. Returns false and logs if [index_start, index_end] is not a valid range of traces within the file
 */
-void liberad_write_trace(LiberadFile* efile, EradTraceHeader* t_header, uint8_t* data){
-  if (!efile->is_open){
-    cout << "File not opened"<< endl;
-    return;
+bool liberad_check_trace_range(LiberadFile* efile, int64_t index_start, int64_t index_end){
+  if (index_start < 0 || index_end < index_start || index_end >= efile->trace_count){
+    cout << "trace range out of bounds"<< endl;
+    return false;
   }
-  fseek(efile->stream, liberad_get_trace_header_index_at(t_header->trace_index, t_header->sample_size, efile->file_ver), SEEK_SET);
-  write_th_v2(efile->stream, t_header);
-  fwrite(data, t_header->sample_size, 1, efile->stream);
-  efile->trace_count++;
-
+  return true;
 }
 
 
-/* Writes a final int64_t trace_count value to file denoting the total number of traces stored in the file
+/* Private funct. Returns the number of whole traces of trace_size bytes read per span, capped at trace_total
 */
-void liberad_finish_write(LiberadFile* efile){
-  if (efile->trace_count == 0){
-    cout << "nothing written to file" << endl;
-    return;
+int64_t liberad_get_span_trace_count(long int trace_size, int64_t trace_total){
+  int64_t span_traces = LIBERAD_BULK_READ_SIZE / trace_size;
+  if (span_traces < 1){
+    span_traces = 1;
   }
-  fwrite(&efile->trace_count, sizeof(efile->trace_count), 1, efile->stream);
-  fflush(efile->stream);
+  return span_traces < trace_total ? span_traces : trace_total;
 }
 
 
-/* Private funct. Writes an EradTraceHeader instance's fields to file . This preferred to a bulk
-* fwrite(&th, TH_SIZE_VER_2, 1, stream) because of memory padding and alignment on different systems. Presumes an
-* opened stream and a stream pointer previoiusly set to exact point in file (with fseek)
+/* Private funct. Returns a pointer to size bytes of file content starting at byte offset. In mmap mode this points into
+* the mapping, otherwise the span is read into buffer with a single read. Returns nullptr on a short read.
 */
-void write_th_v2(FILE* stream, EradTraceHeader* th){
+const uint8_t* liberad_read_span(LiberadFile* efile, long int offset, long int size, uint8_t* buffer){
+  if (efile->map != nullptr){
+    return (offset + size <= efile->map_size) ? efile->map + offset : nullptr;
+  }
+  return (liberad_read_at(efile, offset, buffer, size) == SUCCESS) ? buffer : nullptr;
+}
 
-    fwrite(&th->trace_index, sizeof(th->trace_index), 1, stream);
-    fwrite(&th->sample_size, sizeof(th->sample_size), 1, stream);
-    fwrite(&th->steps_per_trace, sizeof(th->steps_per_trace), 1, stream);
-    fwrite(&th->hour, sizeof(th->hour), 1, stream);
-    fwrite(&th->minute, sizeof(th->minute), 1, stream);
-    fwrite(&th->second, sizeof(th->second), 1, stream);
-    fwrite(&th->millisecond, sizeof(th->millisecond), 1, stream);
-    fwrite(&th->fold_index, sizeof(th->fold_index), 1, stream);
-    fwrite(&th->fold_orientation, sizeof(th->fold_orientation), 1, stream);
-    fwrite(&th->trace_index_in_fold, sizeof(th->trace_index_in_fold), 1, stream);
-    fwrite(&th->x_local, sizeof(th->x_local), 1, stream);
-    fwrite(&th->y_local, sizeof(th->y_local), 1, stream);
-    fwrite(&th->z_local, sizeof(th->z_local), 1, stream);
-    fwrite(&th->longitude, sizeof(th->longitude), 1, stream);
-    fwrite(&th->latitude, sizeof(th->latitude), 1, stream);
 
-    fflush(stream);
+/* Private funct. Walks traces index_start to index_end (inclusive) in spans of whole traces (headers included) and
+* calls visit(span, first_trace_in_span, trace_count_in_span) for each one. Presumes a checked trace range.
+*/
+template<typename Visitor>
+void liberad_for_each_span(LiberadFile* efile, int64_t index_start, int64_t index_end, Visitor visit){
+  int sample_size = efile->f_header->sample_size;
+  long int trace_size = liberad_get_trace_size(sample_size, efile->file_ver);
+  int64_t span_traces = liberad_get_span_trace_count(trace_size, index_end - index_start + 1);
+  bool copy = efile->map == nullptr || efile->blocks != nullptr;
+  uint8_t* buffer = copy ? new uint8_t[span_traces * trace_size] : nullptr;
+
+  for (int64_t first = index_start; first <= index_end; first += span_traces){
+    int64_t count = (index_end - first + 1 < span_traces) ? index_end - first + 1 : span_traces;
+    long int offset = liberad_get_trace_header_index_at(first, sample_size, efile->file_ver);
+    const uint8_t* span = (efile->blocks != nullptr) ?
+                          ((liberad_read_trace_span(efile, first, count, buffer) == SUCCESS) ? buffer : nullptr) :
+                          liberad_read_span(efile, offset, count * trace_size, buffer);
+    if (span == nullptr){
+      cout << "could not read traces " << first << " to " << first + count - 1 << endl;
+      break;
+    }
+    visit(span, first, count);
+  }
 
+  delete[] buffer;
 }
 
+/* -----------------------------------Trace cache----------------------------------------------------------------- */
 
-/*  Private funct. Writes an EradFileHeader instance's fields to file . This preferred to a bulk
-* fwrite(&fh, FH_SIZE, 1, stream) because of memory padding and alignment on different systems. Presumes an
-* opened stream and a stream pointer previoiusly set to exact point in file (with fseek)
+/* A block of block_traces consecutive whole traces (headers included) held by the trace cache
 */
-void write_fh(FILE* stream, EradFileHeader* fh){
+struct LiberadCacheBlock{
 
-    fwrite(&fh->magic_num , sizeof(int8_t), 8, stream);
-    fwrite(&fh->file_version , sizeof(fh->file_version), 1, stream);
-    fwrite(&fh->endianness_marker , sizeof(int8_t), 2, stream);
-    fwrite(&fh->hardware_version , sizeof(fh->hardware_version), 1, stream);
-    fwrite(&fh->radar_type , sizeof(fh->radar_type), 1, stream);
-    fwrite(&fh->year , sizeof(fh->year), 1, stream);
-    fwrite(&fh->month , sizeof(fh->month), 1, stream);
-    fwrite(&fh->day , sizeof(fh->day), 1, stream);
-    fwrite(&fh->dimension , sizeof(fh->dimension), 1, stream);
-    fwrite(&fh->data_offset , sizeof(fh->data_offset), 1, stream);
-    fwrite(&fh->time_window , sizeof(fh->time_window), 1, stream);
-    fwrite(&fh->total_x , sizeof(fh->total_x), 1, stream);
-    fwrite(&fh->total_y , sizeof(fh->total_y), 1, stream);
-    fwrite(&fh->sample_size , sizeof(fh->sample_size), 1, stream);
-    fwrite(&fh->steps_per_meter , sizeof(fh->steps_per_meter), 1, stream);
-    fwrite(&fh->coordinate_system , sizeof(fh->coordinate_system), 1, stream);
-    fwrite(&fh->dielectric_coeff , sizeof(fh->dielectric_coeff), 1, stream);
-    fwrite(&fh->interval_x , sizeof(fh->interval_x), 1, stream);
-    fwrite(&fh->interval_y , sizeof(fh->interval_y), 1, stream);
-    fwrite(&fh->scan_operator , sizeof(char), 58, stream);
-    fwrite(&fh->location , sizeof(char), 102, stream);
+  std::list<int64_t>::iterator lru_position;
+  std::vector<uint8_t> buffer;
+  int64_t trace_count = 0;
 
-    fflush(stream);
+};
 
-}
 
+/* Bounded LRU cache of trace blocks keyed by block number (trace_index / block_traces)
+*/
+struct LiberadTraceCache{
+
+  long int trace_size = 0;
+  int64_t block_traces = 0;
+  int64_t max_blocks = 0;
 
-/* -------------------------------------Segy export operations----------------------------------------------- */
+  std::list<int64_t> lru;
+  std::unordered_map<int64_t, LiberadCacheBlock> blocks;
+  EradCacheStats stats;
+  std::mutex mutex;
 
+};
 
-/* Exports an erad file to a segy file
+
+/* Enables, resizes or (budget_bytes == 0) disables the trace cache of efile. Misses fill a whole block of block_traces
+* consecutive traces and least recently used blocks are evicted to stay within budget_bytes, which must hold one block.
 */
-void liberad_export_to_segy(LiberadFile* source, const char* destination){
-  if (!(source->is_open && source->is_valid) ){
-    cout << "source file not open or valid" << endl;
-    return;
+int liberad_set_trace_cache(LiberadFile* efile, int64_t budget_bytes, int block_traces){
+  delete efile->cache;
+  efile->cache = nullptr;
+
+  if (budget_bytes <= 0){
+    return SUCCESS;
+  }
+  if (!efile->is_valid || efile->f_header == nullptr || block_traces < 1){
+    cout << "File not compatible or invalid cache block size"<< endl;
+    return ERROR;
   }
 
-  if (source->file_size == 0){
-    EradFileHeader f_header;
-    liberad_get_file_info(source, &f_header);
+  LiberadTraceCache* cache = new LiberadTraceCache();
+  cache->trace_size = liberad_get_trace_size(efile->f_header->sample_size, efile->file_ver);
+  cache->block_traces = block_traces;
+  cache->max_blocks = budget_bytes / (cache->trace_size * block_traces);
+  if (cache->max_blocks < 1){
+    cout << "cache budget smaller than one block of " << cache->trace_size * block_traces << " bytes" << endl;
+    delete cache;
+    return ERROR;
   }
+  efile->cache = cache;
+  return SUCCESS;
+}
 
-  FILE* dest = fopen(destination, "wb");
-  if (dest == NULL){
-    cout << "error opening segy destination location" << endl;
+
+/* Copies efile's trace cache counters into stats. All zero when the cache is disabled.
+*/
+void liberad_get_trace_cache_stats(LiberadFile* efile, EradCacheStats* stats){
+  if (efile->cache == nullptr){
+    *stats = EradCacheStats();
     return;
   }
+  lock_guard<mutex> lock(efile->cache->mutex);
+  *stats = efile->cache->stats;
+}
 
 
-  fseek(dest, 0, SEEK_SET);
-  char* segy_txt_header = new char[SEGY_TXT_HEADER_SIZE];
+/* Private funct. Copies the raw header and/or samples of trace_index out of the cache, filling its block on a miss.
+* The block is read without holding the cache lock. Returns false if the block cannot be read.
+*/
+bool liberad_cache_read(LiberadFile* efile, int64_t trace_index, uint8_t* th_raw, uint8_t* data){
+  LiberadTraceCache* cache = efile->cache;
+  if (trace_index < 0 || trace_index >= efile->trace_count){
+    return false;
+  }
+  int sample_size = efile->f_header->sample_size;
+  long int th_size = cache->trace_size - sample_size;
+  int64_t block = trace_index / cache->block_traces;
 
-  SegyBinaryHeader bin_header;
-  SegyTraceHeader segy_trace_header;
+  unique_lock<mutex> lock(cache->mutex);
+  unordered_map<int64_t, LiberadCacheBlock>::iterator entry = cache->blocks.find(block);
 
-  liberad_produce_segy_txt_header(source->f_header, segy_txt_header, SEGY_TXT_HEADER_SIZE);
-  liberad_port_erad_segy_bin_file_header(source->f_header, &bin_header);
+  if (entry != cache->blocks.end()){
+    cache->stats.hits++;
+    cache->lru.splice(cache->lru.begin(), cache->lru, entry->second.lru_position);
+  } else {
+    cache->stats.misses++;
+    lock.unlock();
+
+    int64_t first = block * cache->block_traces;
+    int64_t count = (efile->trace_count - first < cache->block_traces) ? efile->trace_count - first : cache->block_traces;
+    vector<uint8_t> buffer(count * cache->trace_size);
+    if (liberad_read_trace_span(efile, first, count, buffer.data()) != SUCCESS){
+      return false;
+    }
 
-  segy_trace_header.year = source->f_header->year;
-  segy_trace_header.day = source->f_header->day;
-  segy_trace_header.sampleInterval = static_cast<int16_t>(round(source->f_header->time_window / 0.585)) ;
+    lock.lock();
+    entry = cache->blocks.find(block);
+    if (entry == cache->blocks.end()){
+      cache->lru.push_front(block);
+      entry = cache->blocks.emplace(block, LiberadCacheBlock()).first;
+      entry->second.lru_position = cache->lru.begin();
+      entry->second.buffer.swap(buffer);
+      entry->second.trace_count = count;
+      cache->stats.cached_blocks++;
+      cache->stats.cached_bytes += entry->second.buffer.size();
+
+      while (cache->stats.cached_blocks > cache->max_blocks){
+        unordered_map<int64_t, LiberadCacheBlock>::iterator evicted = cache->blocks.find(cache->lru.back());
+        cache->stats.cached_blocks--;
+        cache->stats.cached_bytes -= evicted->second.buffer.size();
+        cache->blocks.erase(evicted);
+        cache->lru.pop_back();
+      }
+    }
+  }
 
-  fwrite(segy_txt_header, sizeof(char), SEGY_TXT_HEADER_SIZE, dest);
-  fwrite(&bin_header, SEGY_BIN_HEADER_SIZE, 1, dest);
+  const uint8_t* trace = entry->second.buffer.data() + (trace_index - block * cache->block_traces) * cache->trace_size;
+  if (th_raw != nullptr){
+    memcpy(th_raw, trace, th_size);
+  }
+  if (data != nullptr){
+    memcpy(data, trace + th_size, sample_size);
+  }
+  return true;
+}
 
-  EradTraceHeader t_header;
-  int sample_size = source->f_header->sample_size;
-  uint8_t* data = new uint8_t[sample_size];
-  int16_t* segy_data = new int16_t[sample_size];
 
-  for (int i = 0; i < source->trace_count; i++){
-    liberad_get_trace_at(source, i, &t_header, data);
-    liberad_port_erad_segy_bin_trace_header(&t_header, &segy_trace_header);
-    liberad_port_data_segy(data, segy_data, sample_size);
+/* -----------------------------------Read-ahead prefetcher------------------------------------------------------ */
 
-    fwrite(&segy_trace_header, SEGY_TRACE_HEADER_SIZE, 1, dest);
-    fwrite(segy_data, sizeof(int16_t), sample_size, dest );
-  }
+/* A chunk of whole consecutive traces (headers included) read by the prefetch worker
+*/
+struct LiberadPrefetchChunk{
 
-  delete[] segy_txt_header;
-  delete[] data;
-  delete[] segy_data;
-  fclose(dest);
-}
+  int64_t first_trace = 0;
+  int64_t trace_count = 0;
+  bool valid = false;
+  uint8_t* buffer = nullptr;
 
+};
 
-/* Ports data from an erad file header to a segy textual file header and stores it into txt_header buffer
+
+/* Ring of chunk_count chunk buffers kept filled ahead of the consumer by a background thread. Traces in
+* [window_start, next_trace) are either ready or being read.
 */
-void liberad_produce_segy_txt_header(EradFileHeader* f_header, char* txt_header, int txt_h_size){
-  string radar = liberad_get_radar_string(f_header->radar_type);
+struct LiberadPrefetcher{
 
-  string endOfHeader = "C39 SEG Y REV2.0";
-  endOfHeader.resize(80, ' ');
-  endOfHeader += "C40 END TEXTUAL HEADER";
-  endOfHeader.resize(160, ' ');
+  LiberadFile* efile = nullptr;
+  long int trace_size = 0;
+  int64_t trace_count = 0;
+  int64_t chunk_traces = 0;
 
-  sprintf(txt_header, "File generated by Oerad Tech Ltd \n Recording device: %s \n Time Window: %f \n Samples per Trace: %hd \n Dielectric of surveyed medium: %f \n Recorded on %hd / %hd / %hd \n Location: %s \n Operator: %s \n Offset to raw trace data: 3840 \n Data sample format: 16bit \n Offset to first trace header data: 3600 \n No extended textual headers \n ", radar.c_str(), f_header->time_window, f_header->sample_size, f_header->dielectric_coeff, f_header->day, f_header->month, f_header->year, f_header->location, f_header->scan_operator);
+  std::vector<LiberadPrefetchChunk> chunks;
+  std::deque<int> ready;
+  std::vector<int> free_slots;
+  int64_t window_start = 0;
+  int64_t next_trace = 0;
+  int64_t generation = 0;
+  bool running = true;
 
-  int size_so_far = strlen(txt_header);
-  int size_end_header = endOfHeader.size();
-  // int finalsize = sizeof(txt_header);
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::thread worker;
 
-  memset(txt_header + size_so_far, ' ', txt_h_size - size_so_far - size_end_header);
-  size_so_far = strlen(txt_header);
+};
 
-  strcpy(txt_header + size_so_far, endOfHeader.c_str());
 
+/* Starts a background thread reading chunk_count chunks of about chunk_size bytes ahead of the last trace requested
+* through the trace-by-index API (liberad_get_trace_at & co). Random access restarts the read-ahead at the new position.
+*/
+int liberad_enable_prefetch(LiberadFile* efile, int64_t chunk_size, int chunk_count){
+  if (!efile->is_valid || efile->f_header == nullptr || efile->trace_count <= 0){
+    cout << "File not compatible or file info not read"<< endl;
+    return ERROR;
+  }
+  if (efile->map != nullptr){
+    cout << "prefetch not available for mapped files - use liberad_set_access_hint"<< endl;
+    return ERROR;
+  }
+  if (chunk_count < 1){
+    cout << "prefetch needs at least one chunk"<< endl;
+    return ERROR;
+  }
+  liberad_disable_prefetch(efile);
+
+  LiberadPrefetcher* prefetcher = new LiberadPrefetcher();
+  prefetcher->efile = efile;
+  prefetcher->trace_size = liberad_get_trace_size(efile->f_header->sample_size, efile->file_ver);
+  prefetcher->trace_count = efile->trace_count;
+  prefetcher->chunk_traces = (chunk_size / prefetcher->trace_size > 0) ? chunk_size / prefetcher->trace_size : 1;
+  prefetcher->chunks.resize(chunk_count);
+  for (int i = 0; i < chunk_count; i++){
+    prefetcher->chunks[i].buffer = new uint8_t[prefetcher->chunk_traces * prefetcher->trace_size];
+    prefetcher->free_slots.push_back(i);
+  }
+
+  prefetcher->worker = thread(liberad_prefetch_worker, prefetcher);
+  efile->prefetcher = prefetcher;
+  return SUCCESS;
 }
 
 
-/* Ports data from an erad file header to a segy binary header
+/* Stops the prefetch thread of efile, if any, and frees its chunk buffers
 */
-void liberad_port_erad_segy_bin_file_header(EradFileHeader* f_header, SegyBinaryHeader* segy_bin_header){
+void liberad_disable_prefetch(LiberadFile* efile){
+  LiberadPrefetcher* prefetcher = efile->prefetcher;
+  if (prefetcher == nullptr){
+    return;
+  }
 
-  segy_bin_header->jobID = 1;
-  segy_bin_header->sampleIntervalUs = static_cast<int16_t>(round(f_header->time_window / 0.585)); //somehow this works
-  segy_bin_header->samplesPerDataTrace = f_header->sample_size;
+  {
+    lock_guard<mutex> lock(prefetcher->mutex);
+    prefetcher->running = false;
+  }
+  prefetcher->cv.notify_all();
+  prefetcher->worker.join();
 
+  for (size_t i = 0; i < prefetcher->chunks.size(); i++){
+    delete[] prefetcher->chunks[i].buffer;
+  }
+  delete prefetcher;
+  efile->prefetcher = nullptr;
 }
 
 
-/* Ports data from an erad trace header to a segy trace header
+/* Private funct. Copies the raw header and/or samples of trace_index out of the prefetched chunks, waiting for the read
+* in flight if needed. Returns false if the trace cannot be served from read-ahead - the caller then reads it directly.
 */
-void liberad_port_erad_segy_bin_trace_header(EradTraceHeader* t_header, SegyTraceHeader* segy_t_header){
+bool liberad_prefetch_read(LiberadPrefetcher* prefetcher, int64_t trace_index, uint8_t* th_raw, uint8_t* data){
+  if (trace_index < 0 || trace_index >= prefetcher->trace_count){
+    return false;
+  }
+  int sample_size = prefetcher->efile->f_header->sample_size;
+  long int th_size = prefetcher->trace_size - sample_size;
+
+  unique_lock<mutex> lock(prefetcher->mutex);
+  while (true){
+    // chunks wholly behind the consumer are done with
+    while (!prefetcher->ready.empty()){
+      LiberadPrefetchChunk& front = prefetcher->chunks[prefetcher->ready.front()];
+      if (front.first_trace + front.trace_count > trace_index){
+        break;
+      }
+      prefetcher->window_start = front.first_trace + front.trace_count;
+      prefetcher->free_slots.push_back(prefetcher->ready.front());
+      prefetcher->ready.pop_front();
+      prefetcher->cv.notify_all();
+    }
 
-  segy_t_header->traceSequenceNumInLine = static_cast<int32_t> (t_header->trace_index);
-  segy_t_header->traceSequenceNumInFile = static_cast<int32_t>(t_header->trace_index) ;
-  segy_t_header->originalRecordNum = static_cast<int32_t>(t_header->trace_index);
-  segy_t_header->ensembleNum = static_cast<int32_t>(t_header->trace_index) ;
-  segy_t_header->numSamples = static_cast<int32_t> (t_header->sample_size);
-  segy_t_header->hour = t_header->hour;
-  segy_t_header->minute = t_header->minute;
-  segy_t_header->second = t_header->second;
+    if (!prefetcher->ready.empty()){
+      LiberadPrefetchChunk& front = prefetcher->chunks[prefetcher->ready.front()];
+      if (front.first_trace <= trace_index){
+        if (!front.valid){
+          return false;
+        }
+        const uint8_t* trace = front.buffer + (trace_index - front.first_trace) * prefetcher->trace_size;
+        if (th_raw != nullptr){
+          memcpy(th_raw, trace, th_size);
+        }
+        if (data != nullptr){
+          memcpy(data, trace + th_size, sample_size);
+        }
+        return true;
+      }
+    }
+
+    if (trace_index >= prefetcher->window_start && trace_index < prefetcher->next_trace + prefetcher->chunk_traces){
+      prefetcher->cv.wait(lock);
+      continue;
+    }
 
+    // out of the read-ahead window - restart it at trace_index
+    prefetcher->generation++;
+    while (!prefetcher->ready.empty()){
+      prefetcher->free_slots.push_back(prefetcher->ready.front());
+      prefetcher->ready.pop_front();
+    }
+    prefetcher->window_start = trace_index;
+    prefetcher->next_trace = trace_index;
+    prefetcher->cv.notify_all();
+  }
 }
 
 
-/* Ports raw data (uint8_t) from an Oerad hardware to an int16_t data type. After tests with different free and
-* paid segy software packages, this is the most portable data format.
+/* Private funct. Prefetch thread body - reads the next chunk with a positional read whenever a chunk slot is free.
 */
-void liberad_port_data_segy(uint8_t* data_source, int16_t* data_dest, int data_length){
-  int i;
-  int8_t original;
-  int8_t mask = static_cast<int8_t>(0b10000000);
-  int8_t temp;
-  for (i = 0; i< data_length; i++){
-    original = data_source[i] & 0xFF;
-    temp = original + mask;
-    data_dest[i] = static_cast<int16_t>(temp * 100);
+void liberad_prefetch_worker(LiberadPrefetcher* prefetcher){
+  LiberadFile* efile = prefetcher->efile;
+  unique_lock<mutex> lock(prefetcher->mutex);
+
+  while (prefetcher->running){
+    if (prefetcher->free_slots.empty() || prefetcher->next_trace >= prefetcher->trace_count){
+      prefetcher->cv.wait(lock);
+      continue;
+    }
+
+    int slot = prefetcher->free_slots.back();
+    prefetcher->free_slots.pop_back();
+    int64_t generation = prefetcher->generation;
+    int64_t first = prefetcher->next_trace;
+    int64_t remaining = prefetcher->trace_count - first;
+    int64_t count = (remaining < prefetcher->chunk_traces) ? remaining : prefetcher->chunk_traces;
+    prefetcher->next_trace += count;
+    lock.unlock();
+
+    uint8_t* buffer = prefetcher->chunks[slot].buffer;
+    long int offset = liberad_get_trace_header_index_at(first, efile->f_header->sample_size, efile->file_ver);
+    bool valid = (efile->blocks != nullptr) ? liberad_read_trace_span(efile, first, count, buffer) == SUCCESS :
+                                              liberad_pread(efile->fd, buffer, count * prefetcher->trace_size, offset) == SUCCESS;
+
+    lock.lock();
+    if (generation != prefetcher->generation){
+      prefetcher->free_slots.push_back(slot);
+      continue;
+    }
+    prefetcher->chunks[slot].first_trace = first;
+    prefetcher->chunks[slot].trace_count = count;
+    prefetcher->chunks[slot].valid = valid;
+    prefetcher->ready.push_back(slot);
+    prefetcher->cv.notify_all();
   }
 }
 
 
-/* ----------------------------------------Segy logger operations----------------------------------------------- */
-
+/* -----------------------------------Batched trace fetch-------------------------------------------------------- */
 
-/* Opens an instance of SegyFile for write at filename location
+/* Reads the traces at indices[0..n-1] into caller slots - header of indices[k] into t_headers[k] and its samples into
+* data + k * sample_size. On Linux all reads are submitted together through io_uring and complete out of order, with
+* preadv as fallback.
 */
-int liberad_open_segy_file_w(SegyFile* sfile, const char* filename){
-  if (filename == NULL || filename[0] == '\0'){
-    cout << "filename is empty string " << endl;
+int liberad_get_traces(LiberadFile* efile, const int64_t* indices, size_t n, EradTraceHeader* t_headers, uint8_t* data){
+  if (!efile->is_valid){
+    cout << "File not compatible"<< endl;
+    return ERROR;
+  }
+  for (size_t k = 0; k < n; k++){
+    if (indices[k] < 0 || indices[k] >= efile->trace_count){
+      cout << "trace index out of bounds"<< endl;
+      return ERROR;
+    }
+  }
+
+  int sample_size = efile->f_header->sample_size;
+  long int th_size = liberad_get_trace_size(sample_size, efile->file_ver) - sample_size;
+  uint8_t* th_raw = new uint8_t[n * th_size];
+  struct iovec* iov = new struct iovec[2 * n];
+  bool* done = new bool[n];
+
+  for (size_t k = 0; k < n; k++){
+    iov[2 * k].iov_base = th_raw + k * th_size;
+    iov[2 * k].iov_len = th_size;
+    iov[2 * k + 1].iov_base = data + k * sample_size;
+    iov[2 * k + 1].iov_len = sample_size;
+    done[k] = false;
+  }
+
+  if (efile->map == nullptr && efile->blocks == nullptr){
+    liberad_get_traces_uring(efile, indices, n, iov, done);
+  }
+
+  int result = SUCCESS;
+  for (size_t k = 0; k < n && result == SUCCESS; k++){
+    if (done[k]){
+      continue;
+    }
+    if (efile->map != nullptr || efile->blocks != nullptr){
+      result = liberad_read_trace(efile, indices[k], th_raw + k * th_size, data + k * sample_size);
+    } else {
+      long int index = liberad_get_trace_header_index_at(indices[k], sample_size, efile->file_ver);
+      result = (preadv(efile->fd, &iov[2 * k], 2, index) == th_size + sample_size) ? SUCCESS : ERROR;
+    }
+  }
+
+  if (result == SUCCESS && t_headers != nullptr){
+    for (size_t k = 0; k < n; k++){
+      liberad_decode_trace_header(efile, th_raw + k * th_size, &t_headers[k]);
+    }
+  }
+
+  delete[] th_raw;
+  delete[] iov;
+  delete[] done;
+  return result;
+}
+
+
+#ifdef LIBERAD_HAVE_IO_URING
+
+/* Private. Minimal io_uring instance - submission and completion rings mapped from the kernel. available is false where
+* io_uring could not be set up, so that later batches go straight to preadv. reset marks a ring closed after a failed
+* batch, set up again by the next one.
+*/
+struct LiberadUring{
+
+  int fd = -1;
+  unsigned entries = 0;
+  bool available = false;
+  bool reset = false;
+  mutex lock;
+
+  void* sq_ring = MAP_FAILED;
+  size_t sq_ring_size = 0;
+  void* cq_ring = MAP_FAILED;
+  size_t cq_ring_size = 0;
+  struct io_uring_sqe* sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+  size_t sqes_size = 0;
+
+  unsigned* sq_head = nullptr;
+  unsigned* sq_tail = nullptr;
+  unsigned* sq_mask = nullptr;
+  unsigned* sq_array = nullptr;
+  unsigned* cq_head = nullptr;
+  unsigned* cq_tail = nullptr;
+  unsigned* cq_mask = nullptr;
+  struct io_uring_cqe* cqes = nullptr;
+
+};
+
+
+/* Private funct. Sets up an io_uring with at least entries submission slots. Fails where io_uring is unavailable
+* (old kernel, seccomp) so the caller can fall back to preadv.
+*/
+int liberad_uring_init(LiberadUring* ring, unsigned entries){
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  ring->fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (ring->fd < 0){
+    return ERROR;
+  }
+  ring->entries = params.sq_entries;
+
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  ring->sq_ring = mmap(nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_ring = mmap(nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+  void* sqes = mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  ring->sqes = static_cast<struct io_uring_sqe*>(sqes);
+  if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || sqes == MAP_FAILED){
+    return ERROR;
+  }
+
+  uint8_t* sq = static_cast<uint8_t*>(ring->sq_ring);
+  uint8_t* cq = static_cast<uint8_t*>(ring->cq_ring);
+  ring->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  ring->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  ring->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  ring->cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+  ring->available = true;
+  return SUCCESS;
+}
+
+
+/* Private funct. Tears down an io_uring set up by liberad_uring_init, also after a partial setup. No reads may be in
+* flight - they would complete into freed caller buffers.
+*/
+void liberad_uring_exit(LiberadUring* ring){
+  if (ring->sqes != MAP_FAILED){
+    munmap(ring->sqes, ring->sqes_size);
+    ring->sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+  }
+  if (ring->cq_ring != MAP_FAILED){
+    munmap(ring->cq_ring, ring->cq_ring_size);
+    ring->cq_ring = MAP_FAILED;
+  }
+  if (ring->sq_ring != MAP_FAILED){
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    ring->sq_ring = MAP_FAILED;
+  }
+  if (ring->fd >= 0){
+    close(ring->fd);
+    ring->fd = -1;
+  }
+  ring->available = false;
+}
+
+
+/* Private funct. Returns the io_uring of efile, setting it up on first use. Concurrent first batches race to publish
+* theirs and the losers discard it.
+*/
+LiberadUring* liberad_get_uring(LiberadFile* efile){
+  LiberadUring* ring = __atomic_load_n(&efile->uring, __ATOMIC_ACQUIRE);
+  if (ring != nullptr){
+    return ring;
+  }
+
+  LiberadUring* created = new LiberadUring;
+  if (liberad_uring_init(created, LIBERAD_BATCH_QUEUE_DEPTH) != SUCCESS){
+    liberad_uring_exit(created);
+  }
+  if (!__atomic_compare_exchange_n(&efile->uring, &ring, created, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+    liberad_uring_exit(created);
+    delete created;
+    return ring;
+  }
+  return created;
+}
+
+
+/* Private funct. Closes the io_uring of efile, if one was set up
+*/
+void liberad_free_uring(LiberadFile* efile){
+  if (efile->uring != nullptr){
+    liberad_uring_exit(efile->uring);
+    delete efile->uring;
+    efile->uring = nullptr;
+  }
+}
+
+
+/* Private funct. Submits the readv of every trace in waves of up to the ring size and marks done[k] for each completed
+* one. Traces left undone (io_uring unavailable or busy with another thread's batch, failed or short reads) are read
+* by the caller. If io_uring_enter fails, the reads already submitted are waited for before returning - they target the
+* caller's buffers - and the ring is closed, dropping any submission it never took.
+*/
+int liberad_get_traces_uring(LiberadFile* efile, const int64_t* indices, size_t n, struct iovec* iov, bool* done){
+  LiberadUring* ring = liberad_get_uring(efile);
+  if (n == 0 || !ring->lock.try_lock()){
+    return ERROR;
+  }
+  lock_guard<mutex> guard(ring->lock, adopt_lock);
+  if (ring->reset){
+    ring->reset = false;
+    if (liberad_uring_init(ring, LIBERAD_BATCH_QUEUE_DEPTH) != SUCCESS){
+      liberad_uring_exit(ring);
+    }
+  }
+  if (!ring->available){
+    return ERROR;
+  }
+
+  int sample_size = efile->f_header->sample_size;
+  long int trace_size = liberad_get_trace_size(sample_size, efile->file_ver);
+  int result = SUCCESS;
+
+  for (size_t first = 0; first < n && result == SUCCESS; first += ring->entries){
+    unsigned count = (n - first < ring->entries) ? static_cast<unsigned>(n - first) : ring->entries;
+
+    unsigned start = *ring->sq_tail;
+    unsigned tail = start;
+    for (unsigned i = 0; i < count; i++){
+      size_t k = first + i;
+      unsigned slot = tail & *ring->sq_mask;
+      struct io_uring_sqe* sqe = &ring->sqes[slot];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_READV;
+      sqe->fd = efile->fd;
+      sqe->addr = reinterpret_cast<uint64_t>(&iov[2 * k]);
+      sqe->len = 2;
+      sqe->off = liberad_get_trace_header_index_at(indices[k], sample_size, efile->file_ver);
+      sqe->user_data = k;
+      ring->sq_array[slot] = slot;
+      tail++;
+    }
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+    // after a failure only the reads the kernel took from the submission ring are waited for, by polling if it refuses
+    // to wait
+    unsigned to_submit = count;
+    unsigned pending = count;
+    while ((result == SUCCESS) ? pending > 0 : count - pending < __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) - start){
+      unsigned min_complete = (result == SUCCESS) ? pending : 1;
+      long entered = syscall(__NR_io_uring_enter, ring->fd, (result == SUCCESS) ? to_submit : 0, min_complete,
+                             IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (entered < 0 && errno != EINTR){
+        if (result == ERROR){
+          this_thread::yield();
+        }
+        result = ERROR;
+      }
+      if (entered > 0 && result == SUCCESS){
+        to_submit -= (static_cast<unsigned>(entered) < to_submit) ? static_cast<unsigned>(entered) : to_submit;
+      }
+
+      unsigned head = *ring->cq_head;
+      unsigned cq_tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+      while (head != cq_tail){
+        struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+        done[cqe->user_data] = (cqe->res == trace_size);
+        head++;
+        pending--;
+      }
+      __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+  }
+
+  if (result != SUCCESS){
+    liberad_uring_exit(ring);
+    ring->reset = true;
+  }
+  return result;
+}
+
+#else
+
+int liberad_get_traces_uring(LiberadFile*, const int64_t*, size_t, struct iovec*, bool*){
+  return ERROR;
+}
+
+void liberad_free_uring(LiberadFile*){
+}
+
+#endif
+
+
+/* --------------------------------Trace header index---------------------------------------------------------- */
+
+/* Scans all trace headers of an opened LiberadFile instance once and stores the indexed fields in index columns.
+*/
+int liberad_build_trace_index(LiberadFile* efile, EradTraceIndex* index){
+  if (!efile->is_valid || efile->trace_count <= 0){
+    cout << "File not compatible or empty"<< endl;
+    return ERROR;
+  }
+
+  liberad_resize_trace_index(index, efile->trace_count);
+  index->file_size = efile->file_size;
+
+  int64_t i = 0;
+  liberad_for_each_trace(efile, 0, efile->trace_count - 1, [&](const EradTraceHeader* t_header, const uint8_t*){
+    index->x_local[i] = t_header->x_local;
+    index->y_local[i] = t_header->y_local;
+    index->latitude[i] = t_header->latitude;
+    index->longitude[i] = t_header->longitude;
+    index->hour[i] = t_header->hour;
+    index->minute[i] = t_header->minute;
+    index->second[i] = t_header->second;
+    index->millisecond[i] = t_header->millisecond;
+    index->fold_index[i] = t_header->fold_index;
+    index->fold_orientation[i] = t_header->fold_orientation;
+    i++;
+  });
+
+  if (i != efile->trace_count){
+    cout << "could not index all traces" << endl;
+    return ERROR;
+  }
+  return SUCCESS;
+}
+
+
+/* Writes index to a sidecar file at filename. Columns are stored whole and in system endianness.
+*/
+int liberad_save_trace_index(EradTraceIndex* index, const char* filename){
+  FILE* stream = fopen(filename, "wb");
+  if (stream == NULL){
+    cout << "could not open index file " << endl;
+    return ERROR;
+  }
+
+  int8_t magic[8] = {0x00, 0x45, 0x52, 0x41, 0x44, 0x49, 0x44, 0x58};
+  int8_t version = LIBERAD_INDEX_VERSION;
+  int8_t endianness = system_endianness;
+  int64_t n = index->trace_count;
+
+  fwrite(magic, sizeof(int8_t), 8, stream);
+  fwrite(&version, sizeof(version), 1, stream);
+  fwrite(&endianness, sizeof(endianness), 1, stream);
+  fwrite(&index->file_size, sizeof(index->file_size), 1, stream);
+  fwrite(&index->trace_count, sizeof(index->trace_count), 1, stream);
+
+  fwrite(index->x_local.data(), sizeof(double), n, stream);
+  fwrite(index->y_local.data(), sizeof(double), n, stream);
+  fwrite(index->latitude.data(), sizeof(double), n, stream);
+  fwrite(index->longitude.data(), sizeof(double), n, stream);
+  fwrite(index->hour.data(), sizeof(int8_t), n, stream);
+  fwrite(index->minute.data(), sizeof(int8_t), n, stream);
+  fwrite(index->second.data(), sizeof(int8_t), n, stream);
+  fwrite(index->millisecond.data(), sizeof(int16_t), n, stream);
+  fwrite(index->fold_index.data(), sizeof(int32_t), n, stream);
+  size_t written = fwrite(index->fold_orientation.data(), sizeof(int8_t), n, stream);
+
+  bool failed = (written != static_cast<size_t>(n)) || ferror(stream);
+  fclose(stream);
+  if (failed){
+    cout << "could not write index file " << endl;
+    remove(filename);
+    return ERROR;
+  }
+  return SUCCESS;
+}
+
+
+/* Loads a sidecar index from filename into index. Fails if the sidecar was not written for efile's current size and
+* trace count or on a different endianness system.
+*/
+int liberad_load_trace_index(LiberadFile* efile, EradTraceIndex* index, const char* filename){
+  FILE* stream = fopen(filename, "rb");
+  if (stream == NULL){
+    return ERROR;
+  }
+
+  int8_t magic[8] = {0x00, 0x45, 0x52, 0x41, 0x44, 0x49, 0x44, 0x58};
+  int8_t buffer[8];
+  int8_t version = 0;
+  int8_t endianness = 0;
+  int64_t file_size = 0;
+  int64_t n = 0;
+
+  // a truncated sidecar is rejected before any of its header is trusted
+  if (fread(buffer, sizeof(int8_t), 8, stream) != 8 || fread(&version, sizeof(version), 1, stream) != 1 ||
+      fread(&endianness, sizeof(endianness), 1, stream) != 1 || fread(&file_size, sizeof(file_size), 1, stream) != 1 ||
+      fread(&n, sizeof(n), 1, stream) != 1){
+    fclose(stream);
+    return ERROR;
+  }
+
+  if (memcmp(buffer, magic, 8) != 0 || version != LIBERAD_INDEX_VERSION || endianness != system_endianness ||
+      file_size != efile->file_size || n != efile->trace_count || n <= 0){
+    fclose(stream);
+    return ERROR;
+  }
+
+  liberad_resize_trace_index(index, n);
+  index->file_size = file_size;
+
+  fread(index->x_local.data(), sizeof(double), n, stream);
+  fread(index->y_local.data(), sizeof(double), n, stream);
+  fread(index->latitude.data(), sizeof(double), n, stream);
+  fread(index->longitude.data(), sizeof(double), n, stream);
+  fread(index->hour.data(), sizeof(int8_t), n, stream);
+  fread(index->minute.data(), sizeof(int8_t), n, stream);
+  fread(index->second.data(), sizeof(int8_t), n, stream);
+  fread(index->millisecond.data(), sizeof(int16_t), n, stream);
+  fread(index->fold_index.data(), sizeof(int32_t), n, stream);
+  size_t read = fread(index->fold_orientation.data(), sizeof(int8_t), n, stream);
+
+  fclose(stream);
+  if (read != static_cast<size_t>(n)){
+    liberad_resize_trace_index(index, 0);
+    return ERROR;
+  }
+  return SUCCESS;
+}
+
+
+/* Populates index from the sidecar file next to efile (filename + LIBERAD_INDEX_EXTENSION) if it is valid, otherwise
+* scans the file and tries to persist a fresh sidecar.
+*/
+int liberad_get_trace_index(LiberadFile* efile, EradTraceIndex* index){
+  if (!efile->is_valid){
+    cout << "File not compatible"<< endl;
+    return ERROR;
+  }
+
+  string sidecar = string(efile->filename) + LIBERAD_INDEX_EXTENSION;
+  if (liberad_load_trace_index(efile, index, sidecar.c_str()) == SUCCESS){
+    return SUCCESS;
+  }
+
+  if (liberad_build_trace_index(efile, index) != SUCCESS){
+    return ERROR;
+  }
+  // a read-only location only costs the next open a rescan
+  liberad_save_trace_index(index, sidecar.c_str());
+  return SUCCESS;
+}
+
+
+/* Private funct. Resizes every column of index to trace_count entries
+*/
+void liberad_resize_trace_index(EradTraceIndex* index, int64_t trace_count){
+
+  index->trace_count = trace_count;
+  index->x_local.resize(trace_count);
+  index->y_local.resize(trace_count);
+  index->latitude.resize(trace_count);
+  index->longitude.resize(trace_count);
+  index->hour.resize(trace_count);
+  index->minute.resize(trace_count);
+  index->second.resize(trace_count);
+  index->millisecond.resize(trace_count);
+  index->fold_index.resize(trace_count);
+  index->fold_orientation.resize(trace_count);
+
+}
+
+
+/* -----------------------------------Fold table------------------------------------------------------------------ */
+
+/* Returns the number of folds in an opened LiberadFile instance, populating its fold table on first call.
+*/
+int liberad_get_fold_count(LiberadFile* efile){
+  if (liberad_load_folds(efile) != SUCCESS){
+    return ERROR;
+  }
+  return static_cast<int>(efile->folds.size());
+}
+
+
+/* Returns fold number fold (in file order, not fold_index) of an opened LiberadFile instance, populating its fold table
+* on first call.
+*/
+EradFold* liberad_get_fold(LiberadFile* efile, int fold){
+  if (liberad_load_folds(efile) != SUCCESS){
+    return nullptr;
+  }
+  if (fold < 0 || fold >= static_cast<int>(efile->folds.size())){
+    cout << "fold out of bounds" << endl;
+    return nullptr;
+  }
+  return &efile->folds[fold];
+}
+
+
+/* Reads raw trace data of all traces of fold number fold into data
+*/
+void liberad_get_fold_data(LiberadFile* efile, int fold, uint8_t* data){
+  EradFold* f = liberad_get_fold(efile, fold);
+  if (f == nullptr){
+    return;
+  }
+  liberad_get_trace_data(efile, f->first_trace, f->first_trace + f->trace_count - 1, data);
+}
+
+
+/* Builds the fold table of efile from a trace header index. A new fold starts wherever fold_index or
+* fold_orientation changes between consecutive traces.
+*/
+void liberad_build_fold_table(LiberadFile* efile, EradTraceIndex* index){
+  efile->folds.clear();
+
+  for (int64_t i = 0; i < index->trace_count; i++){
+    double x = index->x_local[i];
+    double y = index->y_local[i];
+
+    if (efile->folds.empty() || efile->folds.back().fold_index != index->fold_index[i] ||
+        efile->folds.back().fold_orientation != index->fold_orientation[i]){
+      EradFold fold;
+      fold.fold_index = index->fold_index[i];
+      fold.fold_orientation = index->fold_orientation[i];
+      fold.first_trace = i;
+      fold.min_x = fold.max_x = x;
+      fold.min_y = fold.max_y = y;
+      efile->folds.push_back(fold);
+    }
+
+    EradFold& fold = efile->folds.back();
+    fold.trace_count++;
+    fold.min_x = (x < fold.min_x) ? x : fold.min_x;
+    fold.max_x = (x > fold.max_x) ? x : fold.max_x;
+    fold.min_y = (y < fold.min_y) ? y : fold.min_y;
+    fold.max_y = (y > fold.max_y) ? y : fold.max_y;
+  }
+
+  efile->folds_loaded = true;
+}
+
+
+/* Private funct. Populates efile's fold table from its trace header index (sidecar or scan) unless already loaded.
+*/
+int liberad_load_folds(LiberadFile* efile){
+  if (efile->folds_loaded){
+    return SUCCESS;
+  }
+
+  EradTraceIndex index;
+  if (liberad_get_trace_index(efile, &index) != SUCCESS){
+    return ERROR;
+  }
+  liberad_build_fold_table(efile, &index);
+  return SUCCESS;
+}
+
+
+/* -------------------------------------Logging data ---------------------------------------------------- */
+
+
+/* Second, O_DIRECT descriptor of a file opened for writing. offset is the (aligned) file offset of write_buffer[0].
+*/
+struct LiberadDirectWriter{
+
+  int fd = -1;
+  int64_t offset = 0;
+  int64_t allocated = 0;
+  int64_t preallocate_size = 0;
+
+};
+
+
+/* Writes a file header to an opened LiberadFile instance. Presumes that relevant header fields are preset.
+*/
+void liberad_write_file_header(LiberadFile* efile, EradFileHeader* f_header){
+  if (!efile->is_open){
+    cout << "File not opened"<< endl;
+    return;
+  }
+  if (efile->mode == LiberadFile::LIBERAD_APPEND && efile->file_size > 0){
+    cout << "file header already written to the resumed log" << endl;
+    return;
+  }
+  int8_t magic[8] = {0x00, 0x45, 0x41, 0x53, 0x59, 0x52, 0x41, 0x44};
+
+  memcpy(f_header->magic_num, magic, 8);
+  f_header->file_version = (efile->blocks != nullptr) ? VER_2019_COMPRESSED : VER_2019;
+  if (system_endianness == BIG_END){
+    f_header->endianness_marker[0] = 0xFE;
+    f_header->endianness_marker[1] = 0xFF;
+
+  } else {
+    f_header->endianness_marker[0] = 0xFF;
+    f_header->endianness_marker[1] = 0xFE;
+  }
+  efile->endianness = system_endianness;
+  efile->file_ver = f_header->file_version;
+
+  uint8_t buffer[FH_SIZE];
+  encode_fh(f_header, buffer, false);
+  liberad_write_bytes(efile, buffer, FH_SIZE);
+  liberad_flush(efile);
+}
+
+
+/* Writes a single trace's header and data samples to an opened LiberadFile instance. Presumes that relevant header fields are preset.
+* With a write buffer set (liberad_set_write_buffer) or compression (liberad_set_compression) traces are appended in call
+* order without seeking.
+*/
+void liberad_write_trace(LiberadFile* efile, EradTraceHeader* t_header, uint8_t* data){
+  if (!efile->is_open){
+    cout << "File not opened"<< endl;
+    return;
+  }
+  uint8_t buffer[TH_SIZE_VER_2];
+  encode_th_v2(t_header, buffer, efile->endianness != system_endianness);
+
+  if (efile->blocks != nullptr){
+    if (liberad_append_block_trace(efile, buffer, data, t_header->sample_size) != SUCCESS){
+      return;
+    }
+  } else {
+    if (efile->write_buffer == nullptr){
+      fseek(efile->stream, liberad_get_write_offset(efile, t_header), SEEK_SET);
+    }
+    liberad_write_bytes(efile, buffer, TH_SIZE_VER_2);
+    liberad_write_bytes(efile, data, t_header->sample_size);
+  }
+  efile->trace_count++;
+
+  if (efile->write_buffer == nullptr){
+    fflush(efile->stream);
+  } else if (efile->flush_interval_ms > 0 &&
+             liberad_get_time_ms() - efile->last_flush_ms >= efile->flush_interval_ms){
+    liberad_flush(efile);
+  }
+  if (efile->checkpoint_interval_ms > 0 &&
+      liberad_get_time_ms() - efile->last_checkpoint_ms >= efile->checkpoint_interval_ms){
+    liberad_checkpoint(efile);
+  }
+
+}
+
+
+/* Private funct. Offset of a trace written without a write buffer - at its trace_index, or in LIBERAD_APPEND mode after
+* the traces already in the log, whatever the caller numbers them from.
+*/
+long int liberad_get_write_offset(LiberadFile* efile, const EradTraceHeader* t_header){
+  int64_t trace_index = (efile->mode == LiberadFile::LIBERAD_APPEND) ? efile->trace_count : t_header->trace_index;
+  return liberad_get_trace_header_index_at(trace_index, t_header->sample_size, efile->file_ver);
+}
+
+
+/* Writes n traces with vectored I/O - headers are encoded into one buffer and submitted together with the samples in
+* pwritev calls of up to LIBERAD_WRITEV_TRACES traces. Traces land at the offset of headers[0].trace_index, or after the
+* already written data with a write buffer set.
+*/
+int liberad_write_traces(LiberadFile* efile, EradTraceHeader* t_headers, const uint8_t* samples, size_t n){
+  if (!efile->is_open){
+    cout << "File not opened"<< endl;
+    return ERROR;
+  }
+  if (n == 0){
+    return SUCCESS;
+  }
+  if (efile->direct_writer != nullptr || efile->blocks != nullptr){
+    for (size_t k = 0; k < n; k++){
+      liberad_write_trace(efile, &t_headers[k], const_cast<uint8_t*>(samples));
+      samples += t_headers[k].sample_size;
+    }
+    return SUCCESS;
+  }
+  if (liberad_flush(efile) != SUCCESS){
+    return ERROR;
+  }
+
+  bool swap = efile->endianness != system_endianness;
+  long int offset = ftell(efile->stream);
+  if (efile->write_buffer == nullptr){
+    offset = liberad_get_write_offset(efile, &t_headers[0]);
+  }
+
+  size_t batch = (n < LIBERAD_WRITEV_TRACES) ? n : LIBERAD_WRITEV_TRACES;
+  std::vector<uint8_t> raw(batch * TH_SIZE_VER_2);
+  std::vector<struct iovec> iov(2 * batch);
+
+  for (size_t first = 0; first < n; first += batch){
+    size_t count = (n - first < batch) ? n - first : batch;
+    long int size = 0;
+    for (size_t k = 0; k < count; k++){
+      EradTraceHeader* t_header = &t_headers[first + k];
+      encode_th_v2(t_header, &raw[k * TH_SIZE_VER_2], swap);
+      iov[2 * k].iov_base = &raw[k * TH_SIZE_VER_2];
+      iov[2 * k].iov_len = TH_SIZE_VER_2;
+      iov[2 * k + 1].iov_base = const_cast<uint8_t*>(samples);
+      iov[2 * k + 1].iov_len = t_header->sample_size;
+      samples += t_header->sample_size;
+      size += TH_SIZE_VER_2 + t_header->sample_size;
+    }
+
+    if (liberad_writev(efile->fd, iov.data(), 2 * count, offset) != SUCCESS){
+      cout << "could not write to file" << endl;
+      return ERROR;
+    }
+    offset += size;
+    efile->trace_count += count;
+  }
+
+  // keep the stream position in step for following liberad_write_trace / liberad_finish_write calls
+  fseek(efile->stream, offset, SEEK_SET);
+  if (efile->checkpoint_interval_ms > 0 &&
+      liberad_get_time_ms() - efile->last_checkpoint_ms >= efile->checkpoint_interval_ms){
+    liberad_checkpoint(efile);
+  }
+  return SUCCESS;
+}
+
+
+/* Writes a final int64_t trace_count value to file denoting the total number of traces stored in the file
+*/
+void liberad_finish_write(LiberadFile* efile){
+  liberad_stop_async_write(efile);
+  if (efile->trace_count == 0){
+    cout << "nothing written to file" << endl;
+    return;
+  }
+  if (efile->blocks != nullptr){
+    liberad_finish_blocks(efile);
+  }
+  liberad_stop_direct_write(efile);
+  uint8_t buffer[sizeof(efile->trace_count)];
+  encode_field<int64_t>(buffer, 0, efile->trace_count, efile->endianness != system_endianness);
+  liberad_write_bytes(efile, buffer, sizeof(efile->trace_count));
+  liberad_flush(efile);
+}
+
+
+/* Sets up (or with buffer_size 0 removes) a write buffer of buffer_size bytes on an opened LiberadFile instance.
+* Buffered data is written out when the buffer is full, when flush_interval_ms have passed since the last flush (checked
+* on each written trace, 0 for size only) and on liberad_flush, liberad_finish_write and liberad_close_file.
+*/
+int liberad_set_write_buffer(LiberadFile* efile, int64_t buffer_size, int flush_interval_ms){
+  if (!efile->is_open){
+    cout << "File not opened"<< endl;
+    return ERROR;
+  }
+  liberad_flush(efile);
+  liberad_stop_direct_write(efile);
+  delete[] efile->write_buffer;
+  efile->write_buffer = nullptr;
+  efile->write_buffer_size = 0;
+  efile->write_buffer_used = 0;
+
+  if (buffer_size > 0){
+    efile->write_buffer = new uint8_t[buffer_size];
+    efile->write_buffer_size = buffer_size;
+    efile->flush_interval_ms = flush_interval_ms;
+    efile->last_flush_ms = liberad_get_time_ms();
+  }
+  return SUCCESS;
+}
+
+
+/* Writes out buffered trace data of an opened LiberadFile instance and flushes the stream - a durability point.
+*/
+int liberad_flush(LiberadFile* efile){
+  if (!efile->is_open){
+    cout << "File not opened"<< endl;
+    return ERROR;
+  }
+
+  int result = SUCCESS;
+  if (efile->direct_writer != nullptr){
+    result = liberad_direct_write_out(efile, true);
+  } else if (efile->write_buffer_used > 0){
+    size_t written = fwrite(efile->write_buffer, 1, efile->write_buffer_used, efile->stream);
+    result = (written == static_cast<size_t>(efile->write_buffer_used)) ? SUCCESS : ERROR;
+    efile->write_buffer_used = 0;
+  }
+  if (fflush(efile->stream) != 0){
+    result = ERROR;
+  }
+  efile->last_flush_ms = liberad_get_time_ms();
+
+  if (result != SUCCESS){
+    cout << "could not write to file" << endl;
+  }
+  return result;
+}
+
+
+/* Sets the interval of trailer checkpoints on an opened LiberadFile instance - 0 turns checkpoints off.
+*/
+int liberad_set_checkpoint_interval(LiberadFile* efile, int interval_ms){
+  if (!efile->is_open){
+    cout << "File not opened"<< endl;
+    return ERROR;
+  }
+  efile->checkpoint_interval_ms = interval_ms;
+  efile->last_checkpoint_ms = liberad_get_time_ms();
+  return SUCCESS;
+}
+
+
+/* Writes out buffered data and a trace_count trailer after it, then syncs the file. The stream position stays at the end
+* of trace data so the next trace overwrites the trailer.
+*/
+int liberad_checkpoint(LiberadFile* efile){
+  if (liberad_flush(efile) != SUCCESS){
+    return ERROR;
+  }
+  efile->last_checkpoint_ms = liberad_get_time_ms();
+  if (efile->blocks != nullptr){
+    // compressed logs are recovered by walking the written blocks - syncing them is enough
+    return liberad_sync_data(efile->direct_writer != nullptr ? efile->direct_writer->fd : efile->fd);
+  }
+  if (efile->trace_count == 0){
+    return SUCCESS;
+  }
+
+  long int offset = ftell(efile->stream);
+  if (efile->direct_writer != nullptr){
+    offset = efile->direct_writer->offset + efile->write_buffer_used;
+    liberad_sync_data(efile->direct_writer->fd);
+  }
+
+  uint8_t buffer[sizeof(efile->trace_count)];
+  encode_field<int64_t>(buffer, 0, efile->trace_count, efile->endianness != system_endianness);
+  struct iovec iov = {buffer, sizeof(buffer)};
+  if (liberad_writev(efile->fd, &iov, 1, offset) != SUCCESS || liberad_sync_data(efile->fd) != SUCCESS){
+    cout << "could not write checkpoint" << endl;
+    return ERROR;
+  }
+  return SUCCESS;
+}
+
+
+/* Private funct. Appends size bytes to the file - through the write buffer if one is set, straight to the stream
+* otherwise. Writes larger than the buffer bypass it, except in direct mode where all data passes the aligned buffer.
+*/
+void liberad_write_bytes(LiberadFile* efile, const uint8_t* data, int64_t size){
+  if (efile->write_buffer == nullptr){
+    fwrite(data, 1, size, efile->stream);
+    return;
+  }
+
+  if (efile->direct_writer != nullptr){
+    while (size > 0){
+      if (efile->write_buffer_used == efile->write_buffer_size && liberad_direct_write_out(efile, false) != SUCCESS){
+        return;
+      }
+      int64_t count = efile->write_buffer_size - efile->write_buffer_used;
+      count = (size < count) ? size : count;
+      memcpy(efile->write_buffer + efile->write_buffer_used, data, count);
+      efile->write_buffer_used += count;
+      data += count;
+      size -= count;
+    }
+    return;
+  }
+
+  if (efile->write_buffer_used + size > efile->write_buffer_size){
+    liberad_flush(efile);
+  }
+  if (size > efile->write_buffer_size){
+    fwrite(data, 1, size, efile->stream);
+    return;
+  }
+  memcpy(efile->write_buffer + efile->write_buffer_used, data, size);
+  efile->write_buffer_used += size;
+}
+
+
+/* Private funct. Writes all iov_count buffers at offset with pwritev. Resumes after partial writes.
+*/
+int liberad_writev(int fd, struct iovec* iov, int iov_count, long int offset){
+  while (iov_count > 0){
+    ssize_t count = pwritev(fd, iov, iov_count, offset);
+    if (count < 0 && errno == EINTR){
+      continue;
+    }
+    if (count <= 0){
+      return ERROR;
+    }
+    offset += count;
+
+    while (iov_count > 0 && static_cast<size_t>(count) >= iov->iov_len){
+      count -= iov->iov_len;
+      iov++;
+      iov_count--;
+    }
+    if (iov_count > 0){
+      iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + count;
+      iov->iov_len -= count;
+    }
+  }
+  return SUCCESS;
+}
+
+
+/* Private funct. Flushes written data of fd to the device - fdatasync where available, fsync elsewhere
+*/
+int liberad_sync_data(int fd){
+#ifdef LIBERAD_HAVE_DIRECT_IO
+  return (fdatasync(fd) == 0) ? SUCCESS : ERROR;
+#else
+  return (fsync(fd) == 0) ? SUCCESS : ERROR;
+#endif
+}
+
+
+/* Private funct. Returns a monotonic timestamp in milliseconds
+*/
+int64_t liberad_get_time_ms(){
+  return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/* -------------------------------------Async logging------------------------------------------------------ */
+
+
+/* Single-producer/single-consumer ring of preallocated trace slots drained by a writer thread. head is advanced by the
+* writer thread only, tail by the producer only.
+*/
+struct LiberadAsyncWriter{
+
+  LiberadFile* efile = nullptr;
+  int64_t slot_count = 0;
+  int64_t slot_size = 0;
+  std::vector<EradTraceHeader> headers;
+  std::vector<uint8_t> data;
+
+  std::atomic<int64_t> head{0};
+  std::atomic<int64_t> tail{0};
+  std::atomic<bool> running{true};
+
+  std::atomic<int64_t> max_queue_depth{0};
+  std::atomic<int64_t> written{0};
+  std::atomic<int64_t> dropped{0};
+  std::atomic<int64_t> overruns{0};
+
+  std::thread worker;
+
+};
+
+
+/* Starts a writer thread for efile and preallocates slot_count slots of max_sample_size bytes. Sets up a write buffer
+* of LIBERAD_ASYNC_WRITE_BUFFER_SIZE bytes unless one was set with liberad_set_write_buffer.
+*/
+int liberad_start_async_write(LiberadFile* efile, int slot_count, int max_sample_size){
+  if (!efile->is_open || efile->mode == LiberadFile::LIBERAD_READ || efile->mode == LiberadFile::LIBERAD_READ_MMAP ||
+      efile->mode == LiberadFile::LIBERAD_READ_POSITIONAL){
+    cout << "File not opened for writing"<< endl;
+    return ERROR;
+  }
+  if (slot_count < 1 || max_sample_size < 1){
+    cout << "async write needs at least one slot of one sample"<< endl;
+    return ERROR;
+  }
+  liberad_stop_async_write(efile);
+
+  if (efile->write_buffer == nullptr){
+    liberad_set_write_buffer(efile, LIBERAD_ASYNC_WRITE_BUFFER_SIZE, 0);
+  }
+
+  LiberadAsyncWriter* writer = new LiberadAsyncWriter();
+  writer->efile = efile;
+  writer->slot_count = slot_count;
+  writer->slot_size = max_sample_size;
+  writer->headers.resize(slot_count);
+  writer->data.resize(static_cast<size_t>(slot_count) * max_sample_size);
+
+  writer->worker = thread(liberad_async_write_worker, writer);
+  efile->async_writer = writer;
+  return SUCCESS;
+}
+
+
+/* Queues a copy of a trace for the writer thread. Never blocks - if the queue is full or the trace does not fit a slot
+* the trace is dropped and counted.
+*/
+int liberad_write_trace_async(LiberadFile* efile, const EradTraceHeader* t_header, const uint8_t* data){
+  LiberadAsyncWriter* writer = efile->async_writer;
+  if (writer == nullptr){
+    return ERROR;
+  }
+  if (t_header->sample_size < 0 || t_header->sample_size > writer->slot_size){
+    writer->overruns.fetch_add(1, memory_order_relaxed);
+    return ERROR;
+  }
+
+  int64_t tail = writer->tail.load(memory_order_relaxed);
+  int64_t depth = tail - writer->head.load(memory_order_acquire);
+  if (depth >= writer->slot_count){
+    writer->dropped.fetch_add(1, memory_order_relaxed);
+    return ERROR;
+  }
+
+  int64_t slot = tail % writer->slot_count;
+  writer->headers[slot] = *t_header;
+  memcpy(&writer->data[slot * writer->slot_size], data, t_header->sample_size);
+  writer->tail.store(tail + 1, memory_order_release);
+
+  if (depth + 1 > writer->max_queue_depth.load(memory_order_relaxed)){
+    writer->max_queue_depth.store(depth + 1, memory_order_relaxed);
+  }
+  return SUCCESS;
+}
+
+
+/* Writes out all queued traces, stops the writer thread of efile, if any, and frees its slots
+*/
+void liberad_stop_async_write(LiberadFile* efile){
+  LiberadAsyncWriter* writer = efile->async_writer;
+  if (writer == nullptr){
+    return;
+  }
+
+  writer->running.store(false, memory_order_release);
+  writer->worker.join();
+  liberad_flush(efile);
+
+  liberad_get_async_write_stats(efile, &efile->async_stats);
+  efile->async_writer = nullptr;
+  delete writer;
+}
+
+
+/* Reads queue and drop counters of efile's async writer, or the final ones of the last stopped writer
+*/
+void liberad_get_async_write_stats(LiberadFile* efile, EradAsyncWriteStats* stats){
+  LiberadAsyncWriter* writer = efile->async_writer;
+  if (writer == nullptr){
+    *stats = efile->async_stats;
+    return;
+  }
+  *stats = EradAsyncWriteStats();
+
+  stats->queue_depth = writer->tail.load(memory_order_acquire) - writer->head.load(memory_order_acquire);
+  stats->max_queue_depth = writer->max_queue_depth.load(memory_order_relaxed);
+  stats->written = writer->written.load(memory_order_relaxed);
+  stats->dropped = writer->dropped.load(memory_order_relaxed);
+  stats->overruns = writer->overruns.load(memory_order_relaxed);
+}
+
+
+/* Private funct. Writer thread - drains all queued slots in one batch through the write buffer and flushes once the
+* queue runs empty. Exits after the last batch queued before liberad_stop_async_write.
+*/
+void liberad_async_write_worker(LiberadAsyncWriter* writer){
+  LiberadFile* efile = writer->efile;
+
+  while (true){
+    bool stopping = !writer->running.load(memory_order_acquire);
+    int64_t head = writer->head.load(memory_order_relaxed);
+    int64_t tail = writer->tail.load(memory_order_acquire);
+
+    if (head == tail){
+      if (stopping){
+        return;
+      }
+      if (efile->write_buffer_used > 0){
+        liberad_flush(efile);
+      }
+      this_thread::sleep_for(chrono::microseconds(LIBERAD_ASYNC_IDLE_US));
+      continue;
+    }
+
+    writer->written.fetch_add(tail - head, memory_order_relaxed);
+    for (; head != tail; head++){
+      int64_t slot = head % writer->slot_count;
+      liberad_write_trace(efile, &writer->headers[slot], &writer->data[slot * writer->slot_size]);
+      writer->head.store(head + 1, memory_order_release);
+    }
+  }
+}
+
+
+/* -------------------------------------Direct I/O logging------------------------------------------------- */
+
+
+/* Switches efile to direct writing: the write buffer is replaced by an aligned buffer of buffer_size bytes written out
+* through an O_DIRECT descriptor, and file extents are reserved with fallocate preallocate_size bytes at a time.
+*/
+int liberad_set_direct_write(LiberadFile* efile, int64_t buffer_size, int64_t preallocate_size){
+  if (!efile->is_open || (efile->mode != LiberadFile::LIBERAD_WRITE && efile->mode != LiberadFile::LIBERAD_APPEND)){
+    cout << "File not opened for writing"<< endl;
+    return ERROR;
+  }
+  if (efile->async_writer != nullptr){
+    cout << "direct write can not be set while async logging runs"<< endl;
+    return ERROR;
+  }
+  int flush_interval_ms = efile->flush_interval_ms;
+  liberad_set_write_buffer(efile, 0, 0);
+  if (buffer_size <= 0){
+    return SUCCESS;
+  }
+
+#ifdef LIBERAD_HAVE_DIRECT_IO
+  int fd = open(efile->filename, O_RDWR | O_DIRECT);
+  if (fd < 0 && errno == EINVAL){
+    cout << "O_DIRECT not supported by file system, writing through page cache" << endl;
+    fd = open(efile->filename, O_RDWR);
+  }
+#else
+  int fd = open(efile->filename, O_RDWR);
+#endif
+  if (fd < 0){
+    cout << "could not open file for direct write" << endl;
+    return ERROR;
+  }
+
+  buffer_size = ((buffer_size + LIBERAD_DIRECT_ALIGNMENT - 1) / LIBERAD_DIRECT_ALIGNMENT) * LIBERAD_DIRECT_ALIGNMENT;
+  buffer_size = (buffer_size < 2 * LIBERAD_DIRECT_ALIGNMENT) ? 2 * LIBERAD_DIRECT_ALIGNMENT : buffer_size;
+  void* buffer = nullptr;
+  if (posix_memalign(&buffer, LIBERAD_DIRECT_ALIGNMENT, buffer_size) != 0){
+    close(fd);
+    cout << "could not allocate direct write buffer" << endl;
+    return ERROR;
+  }
+
+  // the partially written block at the current position is read back and rewritten as a whole
+  int64_t position = ftell(efile->stream);
+  LiberadDirectWriter* direct = new LiberadDirectWriter();
+  direct->fd = fd;
+  direct->offset = (position / LIBERAD_DIRECT_ALIGNMENT) * LIBERAD_DIRECT_ALIGNMENT;
+  direct->allocated = position;
+  direct->preallocate_size = preallocate_size;
+  if (position > direct->offset && pread(fd, buffer, LIBERAD_DIRECT_ALIGNMENT, direct->offset) < position - direct->offset){
+    free(buffer);
+    close(fd);
+    delete direct;
+    cout << "could not read file" << endl;
+    return ERROR;
+  }
+
+  efile->write_buffer = static_cast<uint8_t*>(buffer);
+  efile->write_buffer_size = buffer_size;
+  efile->write_buffer_used = position - direct->offset;
+  efile->flush_interval_ms = flush_interval_ms;
+  efile->last_flush_ms = liberad_get_time_ms();
+  efile->direct_writer = direct;
+  return SUCCESS;
+}
+
+
+/* Writes out the direct write buffer of efile, if any, trims preallocated space off the file and returns to stream writes
+*/
+void liberad_stop_direct_write(LiberadFile* efile){
+  LiberadDirectWriter* direct = efile->direct_writer;
+  if (direct == nullptr){
+    return;
+  }
+
+  int64_t size = direct->offset + efile->write_buffer_used;
+  liberad_direct_write_out(efile, true);
+  if (ftruncate(direct->fd, size) != 0){
+    cout << "could not trim file" << endl;
+  }
+  close(direct->fd);
+
+  free(efile->write_buffer);
+  efile->write_buffer = nullptr;
+  efile->write_buffer_size = 0;
+  efile->write_buffer_used = 0;
+  efile->direct_writer = nullptr;
+  delete direct;
+
+  fseek(efile->stream, size, SEEK_SET);
+}
+
+
+/* Private funct. Writes the direct write buffer at its file offset - whole blocks only, or everything zero padded to the
+* next block when pad is set. The last partial block stays in the buffer and is rewritten by the next write out.
+*/
+int liberad_direct_write_out(LiberadFile* efile, bool pad){
+  LiberadDirectWriter* direct = efile->direct_writer;
+  int64_t used = efile->write_buffer_used;
+  int64_t full = (used / LIBERAD_DIRECT_ALIGNMENT) * LIBERAD_DIRECT_ALIGNMENT;
+  int64_t size = pad ? ((used + LIBERAD_DIRECT_ALIGNMENT - 1) / LIBERAD_DIRECT_ALIGNMENT) * LIBERAD_DIRECT_ALIGNMENT : full;
+  if (size == 0){
+    return SUCCESS;
+  }
+  memset(efile->write_buffer + used, 0, size - used);
+
+#ifdef LIBERAD_HAVE_DIRECT_IO
+  if (direct->offset + size > direct->allocated && direct->preallocate_size > 0){
+    int64_t length = (direct->preallocate_size > size) ? direct->preallocate_size : size;
+    // FALLOC_FL_KEEP_SIZE - the file size keeps tracking written data, which crash recovery relies on
+    if (fallocate(direct->fd, FALLOC_FL_KEEP_SIZE, direct->allocated, length) == 0){
+      direct->allocated += length;
+    } else {
+      // file system without fallocate support
+      direct->preallocate_size = 0;
+    }
+  }
+#endif
+
+  struct iovec iov = {efile->write_buffer, static_cast<size_t>(size)};
+  if (liberad_writev(direct->fd, &iov, 1, direct->offset) != SUCCESS){
+    cout << "could not write to file" << endl;
+    return ERROR;
+  }
+
+  memmove(efile->write_buffer, efile->write_buffer + full, used - full);
+  efile->write_buffer_used = used - full;
+  direct->offset += full;
+  return SUCCESS;
+}
+
+
+/* -------------------------------------Compressed blocks------------------------------------------------- */
+
+
+/* Block layout of a VER_2019_COMPRESSED file. Traces are grouped in blocks of block_traces, each stored as a block header
+* and an entropy coded payload, and located through offsets (block k holds traces k * block_traces onwards). The writer
+* collects a block in pending, readers keep the last decoded block.
+*/
+struct LiberadBlocks{
+
+  CompressionMode mode = COMPRESSION_FAST;
+  int block_traces = 0;
+  long int trace_size = 0;
+  std::vector<int64_t> offsets;
+
+  // writer
+  std::vector<uint8_t> pending;
+  int64_t pending_traces = 0;
+  int64_t next_offset = FH_SIZE;
+  std::vector<uint8_t> encoded;
+
+  // reader
+  int64_t decoded_block = -1;
+  std::vector<uint8_t> decoded;
+  std::vector<uint8_t> payload;
+  std::mutex mutex;
+
+};
+
+
+/* Selects the compressed file version for a file opened with LIBERAD_WRITE. Must precede liberad_write_file_header.
+*/
+int liberad_set_compression(LiberadFile* efile, CompressionMode mode, int block_traces){
+  if (!efile->is_open || efile->mode != LiberadFile::LIBERAD_WRITE){
+    cout << "File not opened for writing"<< endl;
+    return ERROR;
+  }
+  if (ftell(efile->stream) != 0 || efile->write_buffer_used != 0){
+    cout << "compression must be set before the file header is written"<< endl;
+    return ERROR;
+  }
+
+  liberad_free_blocks(efile);
+  if (mode == COMPRESSION_NONE){
+    return SUCCESS;
+  }
+  if (block_traces < 1){
+    cout << "invalid compression block size"<< endl;
+    return ERROR;
+  }
+
+  efile->blocks = new LiberadBlocks();
+  efile->blocks->mode = mode;
+  efile->blocks->block_traces = block_traces;
+  return SUCCESS;
+}
+
+
+/* Private funct. Frees the block index and codec state of efile
+*/
+void liberad_free_blocks(LiberadFile* efile){
+  delete efile->blocks;
+  efile->blocks = nullptr;
+}
+
+
+/* Private funct. Adds an encoded trace header and its samples to the pending block, writing the block once it is full.
+* All traces of a compressed file share the sample_size of the first one.
+*/
+int liberad_append_block_trace(LiberadFile* efile, const uint8_t* th_raw, const uint8_t* data, int sample_size){
+  LiberadBlocks* blocks = efile->blocks;
+  if (blocks->trace_size == 0){
+    blocks->trace_size = TH_SIZE_VER_2 + sample_size;
+  }
+  if (blocks->trace_size != TH_SIZE_VER_2 + sample_size){
+    cout << "sample_size differs from first trace of compressed file"<< endl;
+    return ERROR;
+  }
+
+  blocks->pending.insert(blocks->pending.end(), th_raw, th_raw + TH_SIZE_VER_2);
+  blocks->pending.insert(blocks->pending.end(), data, data + sample_size);
+  blocks->pending_traces++;
+  if (blocks->pending_traces == blocks->block_traces){
+    return liberad_write_block(efile);
+  }
+  return SUCCESS;
+}
+
+
+/* Private funct. Compresses the pending block and writes it through the regular write path.
+*/
+int liberad_write_block(LiberadFile* efile){
+  LiberadBlocks* blocks = efile->blocks;
+  if (blocks->pending_traces == 0){
+    return SUCCESS;
+  }
+  bool swap = efile->endianness != system_endianness;
+
+  blocks->encoded.assign(LIBERAD_BLOCK_HEADER_SIZE, 0);
+  liberad_encode_block(blocks->pending.data(), blocks->pending_traces, blocks->trace_size, blocks->mode, &blocks->encoded);
+  encode_field<int32_t>(blocks->encoded.data(), 0, blocks->encoded.size() - LIBERAD_BLOCK_HEADER_SIZE, swap);
+  encode_field<int32_t>(blocks->encoded.data(), 4, blocks->pending_traces, swap);
+  encode_field<int16_t>(blocks->encoded.data(), 8, blocks->trace_size - TH_SIZE_VER_2, swap);
+  encode_field<int8_t>(blocks->encoded.data(), 10, blocks->mode, false);
+
+  liberad_write_bytes(efile, blocks->encoded.data(), blocks->encoded.size());
+  blocks->offsets.push_back(blocks->next_offset);
+  blocks->next_offset += blocks->encoded.size();
+  blocks->pending.clear();
+  blocks->pending_traces = 0;
+  return SUCCESS;
+}
+
+
+/* Private funct. Writes the last, partial block and the block offset index. The trace_count trailer follows.
+*/
+void liberad_finish_blocks(LiberadFile* efile){
+  LiberadBlocks* blocks = efile->blocks;
+  bool swap = efile->endianness != system_endianness;
+  liberad_write_block(efile);
+
+  vector<uint8_t> footer(blocks->offsets.size() * sizeof(int64_t) + LIBERAD_BLOCK_FOOTER_SIZE, 0);
+  for (size_t k = 0; k < blocks->offsets.size(); k++){
+    encode_field<int64_t>(footer.data(), k * sizeof(int64_t), blocks->offsets[k], swap);
+  }
+  uint8_t* tail = footer.data() + blocks->offsets.size() * sizeof(int64_t);
+  encode_field<int32_t>(tail, 0, blocks->block_traces, swap);
+  encode_field<int64_t>(tail, 8, blocks->offsets.size(), swap);
+  liberad_write_bytes(efile, footer.data(), footer.size());
+}
+
+
+/* Private funct. Reads the block offset index of a VER_2019_COMPRESSED file (file info read). A file without a valid
+* footer (unfinished log) is recovered by walking the chain of block headers from the file header on.
+*/
+int liberad_load_blocks(LiberadFile* efile){
+  bool swap = efile->endianness != system_endianness;
+  int sample_size = efile->f_header->sample_size;
+  int64_t trailer_size = sizeof(efile->trace_count);
+
+  liberad_free_blocks(efile);
+  efile->blocks = new LiberadBlocks();
+  LiberadBlocks* blocks = efile->blocks;
+  blocks->trace_size = TH_SIZE_VER_2 + sample_size;
+
+  uint8_t tail[LIBERAD_BLOCK_FOOTER_SIZE];
+  long int tail_offset = efile->file_size - trailer_size - LIBERAD_BLOCK_FOOTER_SIZE;
+  if (tail_offset > FH_SIZE && liberad_read_at(efile, tail_offset, tail, LIBERAD_BLOCK_FOOTER_SIZE) == SUCCESS){
+    int block_traces = decode_field<int32_t>(tail, 0, swap);
+    int64_t block_count = decode_field<int64_t>(tail, 8, swap);
+    long int index_offset = tail_offset - block_count * sizeof(int64_t);
+
+    if (block_traces > 0 && block_count > 0 && index_offset >= FH_SIZE &&
+        efile->trace_count > (block_count - 1) * block_traces && efile->trace_count <= block_count * block_traces){
+      vector<uint8_t> raw(block_count * sizeof(int64_t));
+      if (liberad_read_at(efile, index_offset, raw.data(), raw.size()) == SUCCESS){
+        blocks->block_traces = block_traces;
+        blocks->offsets.resize(block_count);
+        for (int64_t k = 0; k < block_count; k++){
+          blocks->offsets[k] = decode_field<int64_t>(raw.data(), k * sizeof(int64_t), swap);
+        }
+        if (blocks->offsets[0] == FH_SIZE){
+          return SUCCESS;
+        }
+      }
+    }
+  }
+
+  // unfinished log - all blocks but the last one hold block_traces traces
+  blocks->offsets.clear();
+  int64_t trace_count = 0;
+  long int offset = FH_SIZE;
+  uint8_t header[LIBERAD_BLOCK_HEADER_SIZE];
+  while (offset + LIBERAD_BLOCK_HEADER_SIZE <= efile->file_size &&
+         liberad_read_at(efile, offset, header, LIBERAD_BLOCK_HEADER_SIZE) == SUCCESS){
+    int64_t size = decode_field<int32_t>(header, 0, swap);
+    int count = decode_field<int32_t>(header, 4, swap);
+    int mode = decode_field<int8_t>(header, 10, false);
+    if (size <= 0 || offset + LIBERAD_BLOCK_HEADER_SIZE + size > efile->file_size || count <= 0 ||
+        decode_field<int16_t>(header, 8, swap) != sample_size || (mode != COMPRESSION_FAST && mode != COMPRESSION_HIGH)){
+      break;
+    }
+    if (blocks->block_traces != 0 && (count > blocks->block_traces || trace_count % blocks->block_traces != 0)){
+      break;
+    }
+    if (blocks->block_traces == 0){
+      blocks->block_traces = count;
+    }
+    blocks->offsets.push_back(offset);
+    trace_count += count;
+    offset += LIBERAD_BLOCK_HEADER_SIZE + size;
+  }
+
+  cout << "block index missing, recovered " << trace_count << " traces" << endl;
+  if (blocks->block_traces == 0){
+    blocks->block_traces = 1;
+  }
+  efile->trace_count = trace_count;
+  efile->is_recovered = true;
+  return (trace_count > 0) ? SUCCESS : ERROR;
+}
+
+
+/* Private funct. Reads block and decodes its traces (file layout, headers included) into traces, which has room for
+* capacity traces. payload is scratch space for the encoded bytes. Positional reads only, so callers with their own
+* buffers need no lock. Returns the number of traces decoded or ERROR.
+*/
+int64_t liberad_read_block(LiberadFile* efile, int64_t block, int64_t capacity, vector<uint8_t>& payload, uint8_t* traces){
+  LiberadBlocks* blocks = efile->blocks;
+  if (block < 0 || block >= static_cast<int64_t>(blocks->offsets.size())){
+    return ERROR;
+  }
+  bool swap = efile->endianness != system_endianness;
+  bool mapped = efile->map != nullptr;
+
+  uint8_t header[LIBERAD_BLOCK_HEADER_SIZE];
+  long int offset = blocks->offsets[block];
+  if ((mapped ? liberad_read_at(efile, offset, header, LIBERAD_BLOCK_HEADER_SIZE) :
+                liberad_pread(efile->fd, header, LIBERAD_BLOCK_HEADER_SIZE, offset)) != SUCCESS){
+    return ERROR;
+  }
+  int64_t size = decode_field<int32_t>(header, 0, swap);
+  int64_t count = decode_field<int32_t>(header, 4, swap);
+  CompressionMode mode = static_cast<CompressionMode>(decode_field<int8_t>(header, 10, false));
+  if (size <= 0 || count <= 0 || count > blocks->block_traces || count > capacity){
+    return ERROR;
+  }
+
+  payload.resize(size);
+  offset += LIBERAD_BLOCK_HEADER_SIZE;
+  if ((mapped ? liberad_read_at(efile, offset, payload.data(), size) :
+                liberad_pread(efile->fd, payload.data(), size, offset)) != SUCCESS ||
+      liberad_decode_block(payload.data(), size, count, blocks->trace_size, mode, traces) != SUCCESS){
+    return ERROR;
+  }
+  return count;
+}
+
+
+/* Private funct. Returns the decoded traces (file layout, headers included) of block, decoding it unless it is the last
+* one decoded. Callers hold blocks->mutex. Returns nullptr if the block cannot be read.
+*/
+const uint8_t* liberad_decode_block_at(LiberadFile* efile, int64_t block){
+  LiberadBlocks* blocks = efile->blocks;
+  if (block == blocks->decoded_block){
+    return blocks->decoded.data();
+  }
+
+  blocks->decoded_block = -1;
+  blocks->decoded.resize(blocks->block_traces * blocks->trace_size);
+  if (liberad_read_block(efile, block, blocks->block_traces, blocks->payload, blocks->decoded.data()) == ERROR){
+    return nullptr;
+  }
+  blocks->decoded_block = block;
+  return blocks->decoded.data();
+}
+
+
+/* Private funct. Reads count consecutive whole traces (headers included, uncompressed file layout) from first on into
+* buffer - decoding the blocks they span in compressed files. Safe to call from several threads: blocks wholly inside
+* the span are decoded straight into buffer, only partial ones go through the shared last-decoded block.
+*/
+int liberad_read_trace_span(LiberadFile* efile, int64_t first, int64_t count, uint8_t* buffer){
+  if (efile->blocks == nullptr){
+    long int trace_size = liberad_get_trace_size(efile->f_header->sample_size, efile->file_ver);
+    long int offset = liberad_get_trace_header_index_at(first, efile->f_header->sample_size, efile->file_ver);
+    if (efile->map == nullptr){
+      return liberad_pread(efile->fd, buffer, count * trace_size, offset);
+    }
+    return liberad_read_at(efile, offset, buffer, count * trace_size);
+  }
+
+  LiberadBlocks* blocks = efile->blocks;
+  vector<uint8_t> payload;
+  while (count > 0){
+    int64_t block = first / blocks->block_traces;
+    int64_t in_block = first - block * blocks->block_traces;
+    int64_t block_count = (block + 1 < static_cast<int64_t>(blocks->offsets.size())) ?
+                          blocks->block_traces : efile->trace_count - block * blocks->block_traces;
+    int64_t copy = (block_count - in_block < count) ? block_count - in_block : count;
+    if (copy <= 0){
+      return ERROR;
+    }
+    if (in_block == 0 && copy == block_count){
+      if (liberad_read_block(efile, block, copy, payload, buffer) != copy){
+        return ERROR;
+      }
+    } else {
+      lock_guard<mutex> lock(blocks->mutex);
+      const uint8_t* traces = liberad_decode_block_at(efile, block);
+      if (traces == nullptr){
+        return ERROR;
+      }
+      memcpy(buffer, traces + in_block * blocks->trace_size, copy * blocks->trace_size);
+    }
+    buffer += copy * blocks->trace_size;
+    first += copy;
+    count -= copy;
+  }
+  return SUCCESS;
+}
+
+
+/* -------------------------------------Segy export operations----------------------------------------------- */
+
+
+/* Exports source to a SEG-Y file at destination using all hardware threads
+*/
+void liberad_export_to_segy(LiberadFile* source, const char* destination){
+  liberad_export_to_segy(source, destination, 0);
+}
+
+
+/* Exports source to a SEG-Y file at destination with BYTE_2_TWOS samples
+*/
+int liberad_export_to_segy(LiberadFile* source, const char* destination, int thread_count){
+  return liberad_export_to_segy(source, destination, thread_count, SegyBinaryHeader::BYTE_2_TWOS);
+}
+
+
+/* Exports source to a SEG-Y file at destination with samples in format. Both formats have fixed size traces, so the
+* trace range is split in chunks of about LIBERAD_BULK_READ_SIZE output bytes which thread_count workers read, convert
+* and pwrite at their precomputed SEG-Y offsets independently.
+*/
+int liberad_export_to_segy(LiberadFile* source, const char* destination, int thread_count,
+                           SegyBinaryHeader::DataSampleFormat format){
+  uint8_t file_headers[SEGY_TXT_HEADER_SIZE + SEGY_BIN_HEADER_SIZE];
+  uint8_t th_template[SEGY_TRACE_HEADER_SIZE];
+  LiberadSegyKernel kernel = liberad_prepare_segy_export(source, format, file_headers, th_template);
+  if (kernel == nullptr){
+    return ERROR;
+  }
+
+  int dest = open(destination, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (dest < 0){
+    cout << "error opening segy destination location" << endl;
+    return ERROR;
+  }
+
+  struct iovec iov = {file_headers, SEGY_TXT_HEADER_SIZE + SEGY_BIN_HEADER_SIZE};
+  bool failed = liberad_writev(dest, &iov, 1, 0) != SUCCESS;
+
+  int sample_size = source->f_header->sample_size;
+  long int trace_size = liberad_get_trace_size(sample_size, source->file_ver);
+  long int segy_trace_size = SEGY_TRACE_HEADER_SIZE + sample_size * liberad_get_segy_sample_size(format);
+  int64_t chunk_traces = liberad_get_segy_chunk_traces(source, segy_trace_size);
+  int64_t chunk_count = (source->trace_count + chunk_traces - 1) / chunk_traces;
+
+  if (thread_count <= 0){
+    thread_count = thread::hardware_concurrency();
+  }
+  thread_count = (thread_count > chunk_count) ? static_cast<int>(chunk_count) : thread_count;
+  thread_count = (thread_count < 1) ? 1 : thread_count;
+
+  atomic<int64_t> next_chunk(0);
+  atomic<bool> error(failed);
+
+  auto worker = [&](){
+    vector<uint8_t> input(chunk_traces * trace_size);
+    vector<uint8_t> output(chunk_traces * segy_trace_size);
+
+    while (!error){
+      int64_t chunk = next_chunk++;
+      if (chunk >= chunk_count){
+        break;
+      }
+      int64_t first = chunk * chunk_traces;
+      int64_t count = (source->trace_count - first < chunk_traces) ? source->trace_count - first : chunk_traces;
+      if (liberad_convert_segy_chunk(source, first, count, th_template, kernel, segy_trace_size, input.data(),
+                                     output.data()) != SUCCESS){
+        error = true;
+        break;
+      }
+
+      struct iovec chunk_iov = {output.data(), static_cast<size_t>(count * segy_trace_size)};
+      long int offset = SEGY_TXT_HEADER_SIZE + SEGY_BIN_HEADER_SIZE + first * segy_trace_size;
+      if (liberad_writev(dest, &chunk_iov, 1, offset) != SUCCESS){
+        cout << "could not write to segy destination" << endl;
+        error = true;
+      }
+    }
+  };
+
+  vector<thread> pool;
+  for (int i = 1; i < thread_count; i++){
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (size_t i = 0; i < pool.size(); i++){
+    pool[i].join();
+  }
+
+  close(dest);
+  return error ? ERROR : SUCCESS;
+}
+
+
+/* Streams source as a SEG-Y file into the file descriptor fd, which may be a pipe or socket
+*/
+int liberad_export_to_segy_stream(LiberadFile* source, int fd, SegyBinaryHeader::DataSampleFormat format){
+  return liberad_export_to_segy_stream(source, liberad_write_segy_fd, &fd, format);
+}
+
+
+/* Streams source as a SEG-Y file through sink, strictly in file order and never seeking back: the trace count of the
+* binary header comes from the .erad trailer up front. Output is handed over in chunks of about
+* LIBERAD_BULK_READ_SIZE bytes, the file headers together with the first one, and the next chunk is converted on a
+* second thread while sink consumes the current one.
+*/
+int liberad_export_to_segy_stream(LiberadFile* source, LiberadSegySink sink, void* user_data,
+                                  SegyBinaryHeader::DataSampleFormat format){
+  uint8_t th_template[SEGY_TRACE_HEADER_SIZE];
+  vector<uint8_t> file_headers(SEGY_TXT_HEADER_SIZE + SEGY_BIN_HEADER_SIZE);
+  LiberadSegyKernel kernel = liberad_prepare_segy_export(source, format, file_headers.data(), th_template);
+  if (kernel == nullptr){
+    return ERROR;
+  }
+
+  int sample_size = source->f_header->sample_size;
+  long int trace_size = liberad_get_trace_size(sample_size, source->file_ver);
+  long int segy_trace_size = SEGY_TRACE_HEADER_SIZE + sample_size * liberad_get_segy_sample_size(format);
+  int64_t chunk_traces = liberad_get_segy_chunk_traces(source, segy_trace_size);
+  int64_t chunk_count = (source->trace_count + chunk_traces - 1) / chunk_traces;
+  if (chunk_count == 0){
+    return sink(file_headers.data(), file_headers.size(), user_data);
+  }
+
+  // each output buffer leaves room for the file headers in front of its traces
+  int64_t headers_size = SEGY_TXT_HEADER_SIZE + SEGY_BIN_HEADER_SIZE;
+  vector<uint8_t> input[2];
+  vector<uint8_t> output[2];
+  int status[2];
+  for (int i = 0; i < 2; i++){
+    input[i].resize(chunk_traces * trace_size);
+    output[i].resize(headers_size + chunk_traces * segy_trace_size);
+  }
+  memcpy(output[0].data(), file_headers.data(), headers_size);
+
+  auto convert = [&](int64_t chunk){
+    int64_t first = chunk * chunk_traces;
+    int64_t count = (source->trace_count - first < chunk_traces) ? source->trace_count - first : chunk_traces;
+    status[chunk % 2] = liberad_convert_segy_chunk(source, first, count, th_template, kernel, segy_trace_size,
+                                                   input[chunk % 2].data(), output[chunk % 2].data() + headers_size);
+  };
+
+  convert(0);
+  for (int64_t chunk = 0; chunk < chunk_count; chunk++){
+    if (status[chunk % 2] != SUCCESS){
+      return ERROR;
+    }
+    thread converter;
+    if (chunk + 1 < chunk_count){
+      converter = thread(convert, chunk + 1);
+    }
+
+    int64_t first = chunk * chunk_traces;
+    int64_t count = (source->trace_count - first < chunk_traces) ? source->trace_count - first : chunk_traces;
+    int64_t skip = (chunk == 0) ? 0 : headers_size;
+    int result = sink(output[chunk % 2].data() + skip, headers_size - skip + count * segy_trace_size, user_data);
+
+    if (converter.joinable()){
+      converter.join();
+    }
+    if (result != SUCCESS){
+      cout << "could not write to segy sink" << endl;
+      return ERROR;
+    }
+  }
+  return SUCCESS;
+}
+
+
+/* Private funct. Checks source and format for a SEG-Y export and encodes the textual and binary file headers into
+* file_headers and the trace header fields shared by every trace into th_template. Reads the file info into
+* source->header if it had not been read yet. Returns the sample kernel of format, nullptr on error.
+*/
+LiberadSegyKernel liberad_prepare_segy_export(LiberadFile* source, SegyBinaryHeader::DataSampleFormat format,
+                                              uint8_t* file_headers, uint8_t* th_template){
+  if (!(source->is_open && source->is_valid) ){
+    cout << "source file not open or valid" << endl;
+    return nullptr;
+  }
+  LiberadSegyKernel kernel = liberad_select_segy_kernel(format);
+  if (kernel == nullptr){
+    cout << "unsupported segy sample format " << format << endl;
+    return nullptr;
+  }
+
+  if (source->file_size == 0){
+    liberad_get_file_info(source, &source->header);
+  }
+
+  SegyBinaryHeader bin_header;
+  SegyTraceHeader segy_trace_header;
+
+  liberad_produce_segy_txt_header(source->f_header, reinterpret_cast<char*>(file_headers), SEGY_TXT_HEADER_SIZE, format);
+  liberad_port_erad_segy_bin_file_header(source->f_header, &bin_header);
+  bin_header.formatCode = format;
+  bin_header.numOfTracesInFile = source->trace_count;
+  encode_segy_bh(&bin_header, file_headers + SEGY_TXT_HEADER_SIZE);
+
+  segy_trace_header.year = source->f_header->year;
+  segy_trace_header.day = liberad_get_day_of_year(source->f_header->year, source->f_header->month, source->f_header->day);
+  segy_trace_header.sampleInterval = static_cast<int16_t>(round(source->f_header->time_window / 0.585)) ;
+  // encoded once - each trace only patches the fields ported from its erad header
+  encode_segy_th(&segy_trace_header, th_template);
+  return kernel;
+}
+
+
+/* Private funct. Number of traces per export chunk - about LIBERAD_BULK_READ_SIZE output bytes, in whole compressed
+* blocks so that no block is decoded by two chunks
+*/
+int64_t liberad_get_segy_chunk_traces(LiberadFile* source, long int segy_trace_size){
+  int64_t chunk_traces = (LIBERAD_BULK_READ_SIZE / segy_trace_size > 0) ? LIBERAD_BULK_READ_SIZE / segy_trace_size : 1;
+  if (source->blocks != nullptr && source->blocks->block_traces > 0){
+    int64_t block_traces = source->blocks->block_traces;
+    chunk_traces = ((chunk_traces + block_traces - 1) / block_traces) * block_traces;
+  }
+  return chunk_traces;
+}
+
+
+/* Private funct. Reads count traces of source from first into input and converts them to SEG-Y traces of
+* segy_trace_size bytes in output - th_template patched with each erad header, followed by the samples converted by
+* kernel.
+*/
+int liberad_convert_segy_chunk(LiberadFile* source, int64_t first, int64_t count, const uint8_t* th_template,
+                               LiberadSegyKernel kernel, long int segy_trace_size, uint8_t* input, uint8_t* output){
+  if (liberad_read_trace_span(source, first, count, input) != SUCCESS){
+    cout << "could not read traces " << first << " to " << first + count - 1 << endl;
+    return ERROR;
+  }
+
+  int sample_size = source->f_header->sample_size;
+  long int trace_size = liberad_get_trace_size(sample_size, source->file_ver);
+  SegyTraceHeader t_segy;
+  EradTraceHeader t_header;
+  for (int64_t k = 0; k < count; k++){
+    const uint8_t* trace = input + k * trace_size;
+    uint8_t* segy_trace = output + k * segy_trace_size;
+    liberad_decode_trace_header(source, trace, &t_header);
+    liberad_port_erad_segy_bin_trace_header(&t_header, &t_segy);
+    memcpy(segy_trace, th_template, SEGY_TRACE_HEADER_SIZE);
+    patch_segy_th(&t_segy, segy_trace);
+    kernel(trace + trace_size - sample_size, segy_trace + SEGY_TRACE_HEADER_SIZE, sample_size);
+  }
+  return SUCCESS;
+}
+
+
+/* Private funct. LiberadSegySink writing to the file descriptor user_data points to. Resumes after partial writes.
+*/
+int liberad_write_segy_fd(const uint8_t* data, int64_t size, void* user_data){
+  int fd = *static_cast<int*>(user_data);
+  while (size > 0){
+    ssize_t count = write(fd, data, size);
+    if (count < 0 && errno == EINTR){
+      continue;
+    }
+    if (count <= 0){
+      return ERROR;
+    }
+    data += count;
+    size -= count;
+  }
+  return SUCCESS;
+}
+
+
+/* Ports data from an erad file header to a segy textual file header and stores it into txt_header buffer
+*/
+void liberad_produce_segy_txt_header(EradFileHeader* f_header, char* txt_header, int txt_h_size){
+  liberad_produce_segy_txt_header(f_header, txt_header, txt_h_size, SegyBinaryHeader::BYTE_2_TWOS);
+}
+
+
+/* Ports data from an erad file header to a segy textual file header for samples in format and stores it into
+* txt_header buffer
+*/
+void liberad_produce_segy_txt_header(EradFileHeader* f_header, char* txt_header, int txt_h_size,
+                                     SegyBinaryHeader::DataSampleFormat format){
+  string radar = liberad_get_radar_string(f_header->radar_type);
+  string sample_format = (format == SegyBinaryHeader::BYTE_1_TWOS) ? "8bit" :
+                         (format == SegyBinaryHeader::BYTE_1_UNS) ? "8bit unsigned" :
+                         (format == SegyBinaryHeader::BYTE_4_IEEE) ? "32bit IEEE float" :
+                         (format == SegyBinaryHeader::BYTE_4_IBM) ? "32bit IBM float" : "16bit";
+
+  string endOfHeader = "C39 SEG Y REV2.0";
+  endOfHeader.resize(80, ' ');
+  endOfHeader += "C40 END TEXTUAL HEADER";
+  endOfHeader.resize(160, ' ');
+
+  sprintf(txt_header, "File generated by Oerad Tech Ltd \n Recording device: %s \n Time Window: %f \n Samples per Trace: %hd \n Dielectric of surveyed medium: %f \n Recorded on %hd / %hd / %hd \n Location: %s \n Operator: %s \n Offset to raw trace data: 3840 \n Data sample format: %s \n Offset to first trace header data: 3600 \n No extended textual headers \n ", radar.c_str(), f_header->time_window, f_header->sample_size, f_header->dielectric_coeff, f_header->day, f_header->month, f_header->year, f_header->location, f_header->scan_operator, sample_format.c_str());
+
+  int size_so_far = strlen(txt_header);
+  int size_end_header = endOfHeader.size();
+  // int finalsize = sizeof(txt_header);
+
+  // the header fills txt_h_size exactly - no room for a terminating null
+  memset(txt_header + size_so_far, ' ', txt_h_size - size_so_far - size_end_header);
+  memcpy(txt_header + txt_h_size - size_end_header, endOfHeader.data(), size_end_header);
+
+}
+
+
+/* Ports data from an erad file header to a segy binary header
+*/
+void liberad_port_erad_segy_bin_file_header(EradFileHeader* f_header, SegyBinaryHeader* segy_bin_header){
+
+  segy_bin_header->jobID = 1;
+  segy_bin_header->sampleIntervalUs = static_cast<int16_t>(round(f_header->time_window / 0.585)); //somehow this works
+  segy_bin_header->samplesPerDataTrace = f_header->sample_size;
+
+}
+
+
+/* Ports data from an erad trace header to a segy trace header
+*/
+void liberad_port_erad_segy_bin_trace_header(EradTraceHeader* t_header, SegyTraceHeader* segy_t_header){
+
+  segy_t_header->traceSequenceNumInLine = static_cast<int32_t> (t_header->trace_index);
+  segy_t_header->traceSequenceNumInFile = static_cast<int32_t>(t_header->trace_index) ;
+  segy_t_header->originalRecordNum = static_cast<int32_t>(t_header->trace_index);
+  segy_t_header->ensembleNum = static_cast<int32_t>(t_header->trace_index) ;
+  segy_t_header->numSamples = static_cast<int32_t> (t_header->sample_size);
+  segy_t_header->hour = t_header->hour;
+  segy_t_header->minute = t_header->minute;
+  segy_t_header->second = t_header->second;
+
+  // local coordinates in millimetres - a negative scalar divides
+  segy_t_header->scalarCoordinates = -LIBERAD_SEGY_COORDINATE_SCALE;
+  segy_t_header->sourceCoordinateX = static_cast<int32_t>(round(t_header->x_local * LIBERAD_SEGY_COORDINATE_SCALE));
+  segy_t_header->sourceCoordinateY = static_cast<int32_t>(round(t_header->y_local * LIBERAD_SEGY_COORDINATE_SCALE));
+  segy_t_header->groupCoordinateX = segy_t_header->sourceCoordinateX;
+  segy_t_header->groupCoordinateY = segy_t_header->sourceCoordinateY;
+
+}
+
+
+/* Ports raw data (uint8_t) from an Oerad hardware to an int16_t data type. After tests with different free and
+* paid segy software packages, this is the most portable data format.
+*/
+void liberad_port_data_segy(uint8_t* data_source, int16_t* data_dest, int data_length){
+  static const LiberadPortKernel kernel = liberad_select_port_kernel();
+  kernel(data_source, data_dest, data_length);
+}
+
+
+/* Converts trace data from .erad bytes to SEG-Y samples of format, packed big-endian as stored in a SEG-Y file. Signed
+* formats carry the value x - 128, scaled by 100 beyond one byte as liberad_port_data_segy does.
+*/
+int liberad_port_data_segy(const uint8_t* data_source, uint8_t* data_dest, int data_length, SegyBinaryHeader::DataSampleFormat format){
+  LiberadSegyKernel kernel = liberad_select_segy_kernel(format);
+  if (kernel == nullptr){
+    cout << "unsupported segy sample format " << format << endl;
+    return ERROR;
+  }
+  kernel(data_source, data_dest, data_length);
+  return SUCCESS;
+}
+
+
+/* Private funct. Picks the kernel converting .erad bytes to format samples - the AVX2 one where the CPU supports it.
+* nullptr for formats the export does not write.
+*/
+LiberadSegyKernel liberad_select_segy_kernel(int16_t format){
+#ifdef LIBERAD_HAVE_X86_SIMD
+  static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+  switch (format){
+    case SegyBinaryHeader::BYTE_1_TWOS:
+      return avx2 ? liberad_port_segy_1_twos_avx2 : liberad_port_segy_1_twos_scalar;
+    case SegyBinaryHeader::BYTE_2_TWOS:
+      return avx2 ? liberad_port_segy_2_twos_avx2 : liberad_port_segy_2_twos_scalar;
+    case SegyBinaryHeader::BYTE_4_IEEE:
+      return avx2 ? liberad_port_segy_4_ieee_avx2 : liberad_port_segy_4_ieee_scalar;
+    case SegyBinaryHeader::BYTE_4_IBM:
+      return avx2 ? liberad_port_segy_4_ibm_avx2 : liberad_port_segy_4_ibm_scalar;
+  }
+#else
+  switch (format){
+    case SegyBinaryHeader::BYTE_1_TWOS:
+      return liberad_port_segy_1_twos_scalar;
+    case SegyBinaryHeader::BYTE_2_TWOS:
+      return liberad_port_segy_2_twos_scalar;
+    case SegyBinaryHeader::BYTE_4_IEEE:
+      return liberad_port_segy_4_ieee_scalar;
+    case SegyBinaryHeader::BYTE_4_IBM:
+      return liberad_port_segy_4_ibm_scalar;
+  }
+#endif
+  return (format == SegyBinaryHeader::BYTE_1_UNS) ? liberad_port_segy_1_uns : nullptr;
+}
+
+
+/* Private funct. BYTE_1_UNS - .erad bytes are already unsigned 1 byte samples.
+*/
+void liberad_port_segy_1_uns(const uint8_t* data_source, uint8_t* data_dest, int data_length){
+  memcpy(data_dest, data_source, data_length);
+}
+
+
+/* Private funct. BYTE_1_TWOS - flipping the sign bit gives x - 128 in two's complement.
+*/
+void liberad_port_segy_1_twos_scalar(const uint8_t* data_source, uint8_t* data_dest, int data_length){
+  for (int i = 0; i < data_length; i++){
+    data_dest[i] = data_source[i] ^ 0x80;
+  }
+}
+
+
+/* Private funct. BYTE_2_TWOS, big-endian.
+*/
+void liberad_port_segy_2_twos_scalar(const uint8_t* data_source, uint8_t* data_dest, int data_length){
+  bool swap = liberad_get_system_endianness() != BIG_END;
+  for (int i = 0; i < data_length; i++){
+    int16_t sample = static_cast<int16_t>(static_cast<int8_t>(data_source[i] ^ 0x80) * 100);
+    encode_field<int16_t>(data_dest, 2 * i, sample, swap);
+  }
+}
+
+
+/* Private funct. BYTE_4_IEEE, big-endian.
+*/
+void liberad_port_segy_4_ieee_scalar(const uint8_t* data_source, uint8_t* data_dest, int data_length){
+  bool swap = liberad_get_system_endianness() != BIG_END;
+  for (int i = 0; i < data_length; i++){
+    float sample = static_cast<float>(static_cast<int8_t>(data_source[i] ^ 0x80) * 100);
+    encode_field<float>(data_dest, 4 * i, sample, swap);
+  }
+}
+
+
+/* Private funct. BYTE_4_IBM, big-endian.
+*/
+void liberad_port_segy_4_ibm_scalar(const uint8_t* data_source, uint8_t* data_dest, int data_length){
+  bool swap = liberad_get_system_endianness() != BIG_END;
+  for (int i = 0; i < data_length; i++){
+    float sample = static_cast<float>(static_cast<int8_t>(data_source[i] ^ 0x80) * 100);
+    encode_field<uint32_t>(data_dest, 4 * i, liberad_float_to_ibm(sample), swap);
+  }
+}
+
+
+#ifdef LIBERAD_HAVE_X86_SIMD
+
+/* Private funct. AVX2 BYTE_1_TWOS kernel - 32 samples per step.
+*/
+__attribute__((target("avx2")))
+void liberad_port_segy_1_twos_avx2(const uint8_t* data_source, uint8_t* data_dest, int data_length){
+  const __m256i sign = _mm256_set1_epi8(static_cast<char>(0x80));
+  int i = 0;
+  for (; i + 32 <= data_length; i += 32){
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data_source + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data_dest + i), _mm256_xor_si256(bytes, sign));
+  }
+  liberad_port_segy_1_twos_scalar(data_source + i, data_dest + i, data_length - i);
+}
+
+
+/* Private funct. AVX2 BYTE_2_TWOS kernel - 16 samples per step, converted as liberad_port_data_segy_avx2 and byte
+* swapped to big-endian.
+*/
+__attribute__((target("avx2")))
+void liberad_port_segy_2_twos_avx2(const uint8_t* data_source, uint8_t* data_dest, int data_length){
+  const __m256i offset = _mm256_set1_epi16(128);
+  const __m256i scale = _mm256_set1_epi16(100);
+  const __m256i swap16 = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                          1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+  int i = 0;
+  for (; i + 16 <= data_length; i += 16){
+    __m256i words = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data_source + i)));
+    words = _mm256_mullo_epi16(_mm256_sub_epi16(words, offset), scale);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data_dest + 2 * i), _mm256_shuffle_epi8(words, swap16));
+  }
+  liberad_port_segy_2_twos_scalar(data_source + i, data_dest + 2 * i, data_length - i);
+}
+
+
+/* Private funct. AVX2 helper - widens 8 .erad bytes to the int32 values (x - 128) * 100.
+*/
+__attribute__((target("avx2")))
+static inline __m256i liberad_widen_segy_samples(const uint8_t* data_source){
+  __m256i values = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data_source)));
+  return _mm256_mullo_epi32(_mm256_sub_epi32(values, _mm256_set1_epi32(128)), _mm256_set1_epi32(100));
+}
+
+
+/* Private funct. AVX2 BYTE_4_IEEE kernel - 8 samples per step, byte swapped to big-endian.
+*/
+__attribute__((target("avx2")))
+void liberad_port_segy_4_ieee_avx2(const uint8_t* data_source, uint8_t* data_dest, int data_length){
+  const __m256i swap32 = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  int i = 0;
+  for (; i + 8 <= data_length; i += 8){
+    __m256i bits = _mm256_castps_si256(_mm256_cvtepi32_ps(liberad_widen_segy_samples(data_source + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data_dest + 4 * i), _mm256_shuffle_epi8(bits, swap32));
+  }
+  liberad_port_segy_4_ieee_scalar(data_source + i, data_dest + 4 * i, data_length - i);
+}
+
+
+/* Private funct. AVX2 BYTE_4_IBM kernel - 8 samples per step. The values are integers below 16^4, so the base 16
+* exponent is counted by comparisons and the 24 bit fraction is the magnitude shifted up to normalised position.
+*/
+__attribute__((target("avx2")))
+void liberad_port_segy_4_ibm_avx2(const uint8_t* data_source, uint8_t* data_dest, int data_length){
+  const __m256i swap32 = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  int i = 0;
+  for (; i + 8 <= data_length; i += 8){
+    __m256i values = liberad_widen_segy_samples(data_source + i);
+    __m256i sign = _mm256_and_si256(values, _mm256_set1_epi32(static_cast<int>(0x80000000)));
+    __m256i magnitude = _mm256_abs_epi32(values);
+    // exponent 1 + [>= 16] + [>= 256] + [>= 4096] - compares yield -1 where true
+    __m256i exponent = _mm256_set1_epi32(1);
+    exponent = _mm256_sub_epi32(exponent, _mm256_cmpgt_epi32(magnitude, _mm256_set1_epi32(15)));
+    exponent = _mm256_sub_epi32(exponent, _mm256_cmpgt_epi32(magnitude, _mm256_set1_epi32(255)));
+    exponent = _mm256_sub_epi32(exponent, _mm256_cmpgt_epi32(magnitude, _mm256_set1_epi32(4095)));
+    __m256i fraction = _mm256_sllv_epi32(magnitude, _mm256_sub_epi32(_mm256_set1_epi32(24), _mm256_slli_epi32(exponent, 2)));
+    __m256i ibm = _mm256_or_si256(_mm256_or_si256(sign, fraction), _mm256_slli_epi32(_mm256_add_epi32(exponent, _mm256_set1_epi32(64)), 24));
+    ibm = _mm256_andnot_si256(_mm256_cmpeq_epi32(magnitude, _mm256_setzero_si256()), ibm);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data_dest + 4 * i), _mm256_shuffle_epi8(ibm, swap32));
+  }
+  liberad_port_segy_4_ibm_scalar(data_source + i, data_dest + 4 * i, data_length - i);
+}
+
+#endif
+
+
+/* Private funct. Converts an IEEE float to an IBM System/360 single precision float, truncating the fraction. Zero and
+* NaN give 0, magnitudes beyond the IBM range saturate the exponent.
+*/
+uint32_t liberad_float_to_ibm(float value){
+  if (value == 0 || value != value){
+    return 0;
+  }
+  uint32_t sign = signbit(value) ? 0x80000000 : 0;
+  int exponent_2;
+  float fraction = frexpf(fabsf(value), &exponent_2);
+  // value = fraction * 2^exponent_2 = (fraction * 2^(exponent_2 - 4 * exponent_16)) * 16^exponent_16, fraction >= 1/16
+  int exponent_16 = (exponent_2 + 3) >> 2;
+  uint32_t bits = static_cast<uint32_t>(ldexpf(fraction, exponent_2 - 4 * exponent_16 + 24));
+  int biased = exponent_16 + 64;
+  biased = (biased < 0) ? 0 : (biased > 127) ? 127 : biased;
+  return sign | static_cast<uint32_t>(biased) << 24 | (bits & 0x00FFFFFF);
+}
+
+
+/* Private funct. Picks the widest liberad_port_data_segy kernel the CPU supports, once per process.
+*/
+LiberadPortKernel liberad_select_port_kernel(){
+#ifdef LIBERAD_HAVE_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512bw")){
+    return liberad_port_data_segy_avx512;
+  }
+  if (__builtin_cpu_supports("avx2")){
+    return liberad_port_data_segy_avx2;
+  }
+  if (__builtin_cpu_supports("sse2")){
+    return liberad_port_data_segy_sse2;
+  }
+#endif
+  return liberad_port_data_segy_scalar;
+}
+
+
+/* Private funct. Scalar sample conversion - flipping the sign bit of an unsigned sample gives the signed value x - 128,
+* which is then scaled by 100. Also finishes the tails of the vector kernels.
+*/
+void liberad_port_data_segy_scalar(const uint8_t* data_source, int16_t* data_dest, int data_length){
+  for (int i = 0; i < data_length; i++){
+    int8_t sample = static_cast<int8_t>(data_source[i] ^ 0x80);
+    data_dest[i] = static_cast<int16_t>(sample * 100);
+  }
+}
+
+
+#ifdef LIBERAD_HAVE_X86_SIMD
+
+/* Private funct. SSE2 kernel - 16 samples per step: zero extend to 16 bits, subtract 128, multiply by 100.
+*/
+__attribute__((target("sse2")))
+void liberad_port_data_segy_sse2(const uint8_t* data_source, int16_t* data_dest, int data_length){
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i offset = _mm_set1_epi16(128);
+  const __m128i scale = _mm_set1_epi16(100);
+  int i = 0;
+  for (; i + 16 <= data_length; i += 16){
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data_source + i));
+    __m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(bytes, zero), offset);
+    __m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(bytes, zero), offset);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data_dest + i), _mm_mullo_epi16(low, scale));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data_dest + i + 8), _mm_mullo_epi16(high, scale));
+  }
+  liberad_port_data_segy_scalar(data_source + i, data_dest + i, data_length - i);
+}
+
+
+/* Private funct. AVX2 kernel - 32 samples per step.
+*/
+__attribute__((target("avx2")))
+void liberad_port_data_segy_avx2(const uint8_t* data_source, int16_t* data_dest, int data_length){
+  const __m256i offset = _mm256_set1_epi16(128);
+  const __m256i scale = _mm256_set1_epi16(100);
+  int i = 0;
+  for (; i + 32 <= data_length; i += 32){
+    __m256i low = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data_source + i)));
+    __m256i high = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data_source + i + 16)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data_dest + i), _mm256_mullo_epi16(_mm256_sub_epi16(low, offset), scale));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data_dest + i + 16), _mm256_mullo_epi16(_mm256_sub_epi16(high, offset), scale));
+  }
+  liberad_port_data_segy_sse2(data_source + i, data_dest + i, data_length - i);
+}
+
+
+/* Private funct. AVX-512 (BW) kernel - 64 samples per step.
+*/
+__attribute__((target("avx512f,avx512bw")))
+void liberad_port_data_segy_avx512(const uint8_t* data_source, int16_t* data_dest, int data_length){
+  const __m512i offset = _mm512_set1_epi16(128);
+  const __m512i scale = _mm512_set1_epi16(100);
+  int i = 0;
+  for (; i + 64 <= data_length; i += 64){
+    __m512i low = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data_source + i)));
+    __m512i high = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data_source + i + 32)));
+    _mm512_storeu_si512(data_dest + i, _mm512_mullo_epi16(_mm512_sub_epi16(low, offset), scale));
+    _mm512_storeu_si512(data_dest + i + 32, _mm512_mullo_epi16(_mm512_sub_epi16(high, offset), scale));
+  }
+  liberad_port_data_segy_sse2(data_source + i, data_dest + i, data_length - i);
+}
+
+#endif
+
+
+/* ----------------------------------------Segy logger operations----------------------------------------------- */
+
+
+/* Opens an instance of SegyFile for write at filename location
+*/
+int liberad_open_segy_file_w(SegyFile* sfile, const char* filename){
+  if (filename == NULL || filename[0] == '\0'){
+    cout << "filename is empty string " << endl;
     return ERROR;
   }
   sfile->filename = filename;
@@ -535,70 +3212,767 @@ int liberad_open_segy_file_w(SegyFile* sfile, const char* filename){
 }
 
 
-/* Opens an instance of SegyFile for write
+/* Opens an instance of SegyFile for write
+*/
+int liberad_open_segy_file_w(SegyFile* sfile){
+  if (sfile->filename == nullptr || sfile->filename[0] == '\0'){
+    cout << "no file location associated with this LiberadFile" << endl;
+    return ERROR;
+  }
+  // get system endianness on first call - maybe put in init call
+  system_endianness = liberad_get_system_endianness();
+  sfile->stream = fopen(sfile->filename, "wb");
+  if (sfile->stream == NULL){
+    return ERROR;
+  }
+  sfile->is_open = true;
+  sfile->trace_offset = SEGY_TXT_HEADER_SIZE + SEGY_BIN_HEADER_SIZE;
+  sfile->trace_count = 0;
+  sfile->has_bin_header = false;
+  return liberad_set_segy_write_buffer(sfile, SEGY_WRITE_BUFFER_SIZE);
+}
+
+
+/* Replaces the write buffer of an opened SegyFile instance by one of buffer_size bytes, 0 writing every trace through
+* to the stream. Buffered traces are written out first.
+*/
+int liberad_set_segy_write_buffer(SegyFile* sfile, int64_t buffer_size){
+  if (!sfile->is_open){
+    cout << "File not opened" << endl;
+    return ERROR;
+  }
+  int result = liberad_flush_segy(sfile);
+  delete[] sfile->write_buffer;
+  sfile->write_buffer = nullptr;
+  sfile->write_buffer_size = 0;
+  sfile->write_buffer_used = 0;
+
+  if (buffer_size > 0){
+    sfile->write_buffer = new uint8_t[buffer_size];
+    sfile->write_buffer_size = buffer_size;
+  }
+  return result;
+}
+
+
+/* Writes out the buffered traces of an opened SegyFile instance at their file offset and flushes the stream
+*/
+int liberad_flush_segy(SegyFile* sfile){
+  if (!sfile->is_open){
+    cout << "File not opened" << endl;
+    return ERROR;
+  }
+
+  int result = SUCCESS;
+  if (sfile->write_buffer_used > 0){
+    fseek(sfile->stream, sfile->trace_offset, SEEK_SET);
+    size_t written = fwrite(sfile->write_buffer, 1, sfile->write_buffer_used, sfile->stream);
+    result = (written == static_cast<size_t>(sfile->write_buffer_used)) ? SUCCESS : ERROR;
+    sfile->trace_offset += sfile->write_buffer_used;
+    sfile->write_buffer_used = 0;
+  }
+  if (fflush(sfile->stream) != 0){
+    result = ERROR;
+  }
+  return result;
+}
+
+
+/* Writes a segy textual header to file from buffer txt_header
+*/
+void liberad_write_segy_txt_h(SegyFile* sfile, char* txt_header){
+  if (!sfile->is_open){
+    cout << "File not opened" << endl;
+    return;
+  }
+  fseek(sfile->stream, 0, SEEK_SET);
+  fwrite(txt_header, sizeof(char), SEGY_TXT_HEADER_SIZE, sfile->stream);
+}
+
+
+/* Writes a segy binary header to file, packed big-endian at its standard offset
+*/
+void liberad_write_segy_bin_h(SegyFile* sfile, SegyBinaryHeader* b_header){
+  if (!sfile->is_open){
+    cout << "File not opened" << endl;
+    return;
+  }
+  uint8_t buffer[SEGY_BIN_HEADER_SIZE];
+  encode_segy_bh(b_header, buffer);
+  fseek(sfile->stream, SEGY_TXT_HEADER_SIZE, SEEK_SET);
+  fwrite(buffer, SEGY_BIN_HEADER_SIZE, 1, sfile->stream);
+  sfile->has_bin_header = true;
+
+}
+
+
+/* Appends a segy trace header packed big-endian followed by data_size bytes of trace data after the last trace written.
+* Traces collect in the write buffer; one that does not fit in an empty buffer is written through.
+*/
+void liberad_write_segy_trace(SegyFile* sfile, SegyTraceHeader* t_header, const void* data, int data_size){
+  if (!sfile->is_open){
+    cout << "File not opened" << endl;
+    return;
+  }
+
+  int64_t trace_size = SEGY_TRACE_HEADER_SIZE + data_size;
+  if (sfile->write_buffer_used + trace_size > sfile->write_buffer_size){
+    liberad_flush_segy(sfile);
+  }
+
+  if (trace_size <= sfile->write_buffer_size){
+    uint8_t* trace = sfile->write_buffer + sfile->write_buffer_used;
+    encode_segy_th(t_header, trace);
+    memcpy(trace + SEGY_TRACE_HEADER_SIZE, data, data_size);
+    sfile->write_buffer_used += trace_size;
+  } else {
+    uint8_t buffer[SEGY_TRACE_HEADER_SIZE];
+    encode_segy_th(t_header, buffer);
+    fseek(sfile->stream, sfile->trace_offset, SEEK_SET);
+    fwrite(buffer, SEGY_TRACE_HEADER_SIZE, 1, sfile->stream);
+    fwrite(data, data_size, 1, sfile->stream);
+    sfile->trace_offset += trace_size;
+  }
+  sfile->trace_count++;
+
+}
+
+
+/* Closes a SegyFile's stream instance - writing out buffered traces and the final trace count into the binary header.
+*/
+void liberad_close_segy_file_w(SegyFile* sfile){
+  if (sfile->is_open){
+    liberad_flush_segy(sfile);
+    if (sfile->has_bin_header){
+      uint8_t count[8];
+      encode_field<int64_t>(count, 0, sfile->trace_count, liberad_get_system_endianness() != BIG_END);
+      fseek(sfile->stream, SEGY_TXT_HEADER_SIZE + 312, SEEK_SET);
+      fwrite(count, sizeof(count), 1, sfile->stream);
+    }
+    fclose(sfile->stream);
+    delete[] sfile->write_buffer;
+    sfile->write_buffer = nullptr;
+    sfile->write_buffer_size = 0;
+    sfile->write_buffer_used = 0;
+    sfile->is_open = false;
+    sfile->stream = nullptr;
+  }
+}
+
+
+/* ----------------------------------------Segy reader operations----------------------------------------------- */
+
+
+/* Opens an instance of SegyFile for read at filename location
+*/
+int liberad_open_segy_file_r(SegyFile* sfile, const char* filename){
+  if (filename == NULL || filename[0] == '\0'){
+    cout << "filename is empty string " << endl;
+    return ERROR;
+  }
+  sfile->filename = filename;
+  return liberad_open_segy_file_r(sfile);
+}
+
+
+/* Opens an instance of SegyFile for read: maps the whole file, decodes the binary header in the byte order its integer
+* constant gives (big-endian when absent) and indexes the traces.
+*/
+int liberad_open_segy_file_r(SegyFile* sfile){
+  if (sfile->filename == nullptr || sfile->filename[0] == '\0'){
+    cout << "no file location associated with this SegyFile" << endl;
+    return ERROR;
+  }
+  system_endianness = liberad_get_system_endianness();
+
+  int fd = open(sfile->filename, O_RDONLY);
+  if (fd < 0){
+    cout << "error opening segy file" << endl;
+    return ERROR;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < SEGY_TXT_HEADER_SIZE + SEGY_BIN_HEADER_SIZE){
+    cout << "segy file too short" << endl;
+    close(fd);
+    return ERROR;
+  }
+  void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED){
+    cout << "could not map segy file" << endl;
+    return ERROR;
+  }
+  sfile->map = static_cast<const uint8_t*>(map);
+  sfile->map_size = st.st_size;
+
+  const uint8_t* bin = sfile->map + SEGY_TXT_HEADER_SIZE;
+  bool little_endian = decode_field<uint32_t>(bin, 96, system_endianness == LITTLE_END) == 0x04030201;
+  sfile->swap = (little_endian ? LITTLE_END : BIG_END) != system_endianness;
+  decode_segy_bh(bin, &sfile->bin_header, sfile->swap);
+
+  if (liberad_get_segy_sample_size(sfile->bin_header.formatCode) == 0 || liberad_index_segy_traces(sfile) != SUCCESS){
+    cout << "unsupported segy file" << endl;
+    munmap(map, st.st_size);
+    sfile->map = nullptr;
+    sfile->map_size = 0;
+    return ERROR;
+  }
+  sfile->trace_count = sfile->trace_offsets.size();
+  sfile->is_open = true;
+  return SUCCESS;
+}
+
+
+/* Private funct. Fills trace_offsets of a mapped SegyFile. Traces start after the extended textual headers (or at the
+* offset the binary header gives) and end before the trailer stanzas. Fixed length traces are laid out arithmetically,
+* variable length ones by walking the sample count of each trace header.
+*/
+int liberad_index_segy_traces(SegyFile* sfile){
+  const SegyBinaryHeader* bh = &sfile->bin_header;
+  int64_t first = SEGY_TXT_HEADER_SIZE + SEGY_BIN_HEADER_SIZE;
+  int64_t end = sfile->map_size;
+
+  if (bh->offsetFirstTrace > 0){
+    first = bh->offsetFirstTrace;
+  } else if (bh->numExtendedTextHeaders > 0){
+    first += static_cast<int64_t>(bh->numExtendedTextHeaders) * SEGY_TXT_HEADER_SIZE;
+  } else if (bh->numExtendedTextHeaders < 0){
+    // variable count - the last stanza is ((SEG: EndText))
+    const char* end_text = "EndText))";
+    for (;first + SEGY_TXT_HEADER_SIZE <= end; first += SEGY_TXT_HEADER_SIZE){
+      const char* stanza = reinterpret_cast<const char*>(sfile->map + first);
+      if (search(stanza, stanza + SEGY_TXT_HEADER_SIZE, end_text, end_text + strlen(end_text)) != stanza + SEGY_TXT_HEADER_SIZE){
+        first += SEGY_TXT_HEADER_SIZE;
+        break;
+      }
+    }
+  }
+  if (bh->numTrailerStanzaRecs > 0){
+    end -= static_cast<int64_t>(bh->numTrailerStanzaRecs) * SEGY_TXT_HEADER_SIZE;
+  }
+  if (first > end){
+    return ERROR;
+  }
+
+  int sample_size = liberad_get_segy_sample_size(bh->formatCode);
+  sfile->trace_offsets.clear();
+  if (first + SEGY_TRACE_HEADER_SIZE > end){
+    return SUCCESS;
+  }
+
+  if (bh->fixedLengthTrace == SegyBinaryHeader::FIXED){
+    int64_t trace_size = SEGY_TRACE_HEADER_SIZE + liberad_get_segy_trace_samples(sfile, sfile->map + first) * sample_size;
+    int64_t count = (end - first) / trace_size;
+    sfile->trace_offsets.resize(count);
+    for (int64_t i = 0; i < count; i++){
+      sfile->trace_offsets[i] = first + i * trace_size;
+    }
+    return SUCCESS;
+  }
+
+  for (int64_t offset = first; offset + SEGY_TRACE_HEADER_SIZE <= end;){
+    int64_t trace_size = SEGY_TRACE_HEADER_SIZE + liberad_get_segy_trace_samples(sfile, sfile->map + offset) * sample_size;
+    if (offset + trace_size > end){
+      break;
+    }
+    sfile->trace_offsets.push_back(offset);
+    offset += trace_size;
+  }
+  return SUCCESS;
+}
+
+
+/* Copies the textual header of a SegyFile opened for read into txt_header, translated to ASCII if stored in EBCDIC
+*/
+void liberad_get_segy_txt_header(SegyFile* sfile, char* txt_header){
+  static const uint8_t ebcdic_to_ascii[256] = {
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x2E, 0x3C, 0x28, 0x2B, 0x7C,
+  0x26, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x21, 0x24, 0x2A, 0x29, 0x3B, 0x20,
+  0x2D, 0x2F, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x2C, 0x25, 0x5F, 0x3E, 0x3F,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x60, 0x3A, 0x23, 0x40, 0x27, 0x3D, 0x22,
+  0x20, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70, 0x71, 0x72, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x7E, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x5E, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x5B, 0x5D, 0x20, 0x20, 0x20, 0x20,
+  0x7B, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x7D, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F, 0x50, 0x51, 0x52, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x5C, 0x20, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20
+  };
+  if (!sfile->is_open || sfile->map == nullptr){
+    cout << "File not opened" << endl;
+    return;
+  }
+  // standard headers start with 'C' - 0xC3 in EBCDIC
+  bool ebcdic = sfile->map[0] == 0xC3;
+  for (int i = 0; i < SEGY_TXT_HEADER_SIZE; i++){
+    txt_header[i] = ebcdic ? static_cast<char>(ebcdic_to_ascii[sfile->map[i]]) : static_cast<char>(sfile->map[i]);
+  }
+}
+
+
+/* Points view at trace trace_index of a SegyFile opened for read - no data is copied
+*/
+int liberad_get_segy_trace(SegyFile* sfile, int64_t trace_index, SegyTraceView* view){
+  if (!sfile->is_open || sfile->map == nullptr){
+    cout << "File not opened" << endl;
+    return ERROR;
+  }
+  if (trace_index < 0 || trace_index >= static_cast<int64_t>(sfile->trace_offsets.size())){
+    return ERROR;
+  }
+
+  view->header = sfile->map + sfile->trace_offsets[trace_index];
+  view->data = view->header + SEGY_TRACE_HEADER_SIZE;
+  view->format_code = sfile->bin_header.formatCode;
+  view->swap = sfile->swap;
+  view->sample_count = static_cast<int32_t>(liberad_get_segy_trace_samples(sfile, view->header));
+  return SUCCESS;
+}
+
+
+/* Decodes the trace header a view points at
+*/
+void liberad_get_segy_trace_header(const SegyTraceView* view, SegyTraceHeader* t_header){
+  decode_segy_th(view->header, t_header, view->swap);
+}
+
+
+/* Decodes the samples a view points at into data as floats, whatever the sample format of the file
+*/
+int liberad_get_segy_trace_data(const SegyTraceView* view, float* data){
+  const uint8_t* raw = view->data;
+  bool swap = view->swap;
+  bool big_endian = swap == (system_endianness == LITTLE_END);
+  int n = view->sample_count;
+
+  switch (view->format_code){
+    case SegyBinaryHeader::BYTE_4_IBM:
+      for (int i = 0; i < n; i++) data[i] = liberad_ibm_to_float(decode_field<uint32_t>(raw, 4 * i, swap));
+      break;
+    case SegyBinaryHeader::BYTE_4_TWOS:
+      for (int i = 0; i < n; i++) data[i] = static_cast<float>(decode_field<int32_t>(raw, 4 * i, swap));
+      break;
+    case SegyBinaryHeader::BYTE_2_TWOS:
+      for (int i = 0; i < n; i++) data[i] = decode_field<int16_t>(raw, 2 * i, swap);
+      break;
+    case SegyBinaryHeader::BYTE_4_IEEE:
+      for (int i = 0; i < n; i++) data[i] = decode_field<float>(raw, 4 * i, swap);
+      break;
+    case SegyBinaryHeader::BYTE_8_IEEE:
+      for (int i = 0; i < n; i++) data[i] = static_cast<float>(decode_field<double>(raw, 8 * i, swap));
+      break;
+    case SegyBinaryHeader::BYTE_3_TWOS:
+    case SegyBinaryHeader::BYTE_3_UNS:
+      for (int i = 0; i < n; i++){
+        const uint8_t* s = raw + 3 * i;
+        // sign extend the signed format from bit 23
+        uint32_t value = big_endian ? (s[0] << 16 | s[1] << 8 | s[2]) : (s[2] << 16 | s[1] << 8 | s[0]);
+        bool negative = view->format_code == SegyBinaryHeader::BYTE_3_TWOS && (value & 0x800000);
+        data[i] = negative ? static_cast<float>(static_cast<int32_t>(value | 0xFF000000)) : static_cast<float>(value);
+      }
+      break;
+    case SegyBinaryHeader::BYTE_1_TWOS:
+      for (int i = 0; i < n; i++) data[i] = static_cast<int8_t>(raw[i]);
+      break;
+    case SegyBinaryHeader::BYTE_8_TWOS:
+      for (int i = 0; i < n; i++) data[i] = static_cast<float>(decode_field<int64_t>(raw, 8 * i, swap));
+      break;
+    case SegyBinaryHeader::BYTE_4_UNS:
+      for (int i = 0; i < n; i++) data[i] = static_cast<float>(decode_field<uint32_t>(raw, 4 * i, swap));
+      break;
+    case SegyBinaryHeader::BYTE_2_UNS:
+      for (int i = 0; i < n; i++) data[i] = decode_field<uint16_t>(raw, 2 * i, swap);
+      break;
+    case SegyBinaryHeader::BYTE_8_UNS:
+      for (int i = 0; i < n; i++) data[i] = static_cast<float>(decode_field<uint64_t>(raw, 8 * i, swap));
+      break;
+    case SegyBinaryHeader::BYTE_1_UNS:
+      for (int i = 0; i < n; i++) data[i] = raw[i];
+      break;
+    default:
+      return ERROR;
+  }
+  return SUCCESS;
+}
+
+
+/* Closes a SegyFile opened for read - views into it are invalid from here on
+*/
+void liberad_close_segy_file_r(SegyFile* sfile){
+  if (sfile->map != nullptr){
+    munmap(const_cast<uint8_t*>(sfile->map), sfile->map_size);
+    sfile->map = nullptr;
+    sfile->map_size = 0;
+  }
+  sfile->trace_offsets.clear();
+  sfile->trace_offsets.shrink_to_fit();
+  sfile->trace_count = 0;
+  sfile->is_open = false;
+}
+
+
+/* Private funct. Returns the number of samples of the trace whose header t_header points at: the binary header's count
+* for fixed length traces, the trace header's otherwise (falling back to the binary header's when 0).
+*/
+int64_t liberad_get_segy_trace_samples(SegyFile* sfile, const uint8_t* t_header){
+  int64_t samples = static_cast<uint16_t>(sfile->bin_header.samplesPerDataTrace);
+  if (samples == 0){
+    samples = sfile->bin_header.extendedNumSamplesPerEnsemble;
+  }
+  if (sfile->bin_header.fixedLengthTrace == SegyBinaryHeader::FIXED && samples > 0){
+    return samples;
+  }
+  int64_t trace_samples = decode_field<uint16_t>(t_header, 114, sfile->swap);
+  return (trace_samples == 0) ? samples : trace_samples;
+}
+
+
+/* Private funct. Returns the size in bytes of one sample of SEG-Y format code format, 0 if unsupported
+*/
+int liberad_get_segy_sample_size(int16_t format){
+  switch (format){
+    case SegyBinaryHeader::BYTE_1_TWOS:
+    case SegyBinaryHeader::BYTE_1_UNS:
+      return 1;
+    case SegyBinaryHeader::BYTE_2_TWOS:
+    case SegyBinaryHeader::BYTE_2_UNS:
+      return 2;
+    case SegyBinaryHeader::BYTE_3_TWOS:
+    case SegyBinaryHeader::BYTE_3_UNS:
+      return 3;
+    case SegyBinaryHeader::BYTE_4_IBM:
+    case SegyBinaryHeader::BYTE_4_TWOS:
+    case SegyBinaryHeader::BYTE_4_IEEE:
+    case SegyBinaryHeader::BYTE_4_UNS:
+      return 4;
+    case SegyBinaryHeader::BYTE_8_IEEE:
+    case SegyBinaryHeader::BYTE_8_TWOS:
+    case SegyBinaryHeader::BYTE_8_UNS:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+
+/* Private funct. Converts an IBM System/360 single precision float (sign, base 16 exponent biased by 64, 24 bit
+* fraction) to an IEEE float.
 */
-int liberad_open_segy_file_w(SegyFile* sfile){
-  if (sfile->filename == nullptr || sfile->filename[0] == '\0'){
-    cout << "no file location associated with this LiberadFile" << endl;
+float liberad_ibm_to_float(uint32_t ibm){
+  uint32_t fraction = ibm & 0x00FFFFFF;
+  int exponent = static_cast<int>((ibm >> 24) & 0x7F) - 64;
+  float value = ldexpf(static_cast<float>(fraction), 4 * exponent - 24);
+  return (ibm & 0x80000000) ? -value : value;
+}
+
+
+/* ----------------------------------------Segy import operations----------------------------------------------- */
+
+
+/* Imports a SEG-Y file into a new VER_2019 .erad file with the default amplitude scale, using all hardware threads
+*/
+int liberad_import_segy(const char* source, const char* destination){
+  return liberad_import_segy(source, destination, 0, 0);
+}
+
+
+/* Imports a SEG-Y file into a new VER_2019 .erad file. The source is mapped and indexed by liberad_open_segy_file_r;
+* as both layouts then have known trace offsets, chunks of about LIBERAD_BULK_READ_SIZE output bytes are converted by
+* thread_count workers and written with pwrite at their precomputed .erad offsets. Traces shorter than the longest one
+* are padded with zero amplitude (128), the trailer is written last.
+*/
+int liberad_import_segy(const char* source, const char* destination, float scale, int thread_count){
+  SegyFile sfile;
+  if (liberad_open_segy_file_r(&sfile, source) != SUCCESS){
     return ERROR;
   }
-  // get system endianness on first call - maybe put in init call
-  system_endianness = liberad_get_system_endianness();
-  sfile->stream = fopen(sfile->filename, "wb");
-  if (sfile->stream == NULL){
+  int16_t format = sfile.bin_header.formatCode;
+  if (format != SegyBinaryHeader::BYTE_1_TWOS && format != SegyBinaryHeader::BYTE_1_UNS && format != SegyBinaryHeader::BYTE_2_TWOS &&
+      format != SegyBinaryHeader::BYTE_4_IEEE && format != SegyBinaryHeader::BYTE_4_IBM){
+    cout << "unsupported segy sample format " << format << endl;
+    liberad_close_segy_file_r(&sfile);
     return ERROR;
   }
-  sfile->is_open = true;
-  return SUCCESS;
+  if (scale <= 0){
+    // inverse of liberad_port_data_segy, which scales 1 byte samples by 100
+    scale = (liberad_get_segy_sample_size(format) == 1) ? 1.0f : 0.01f;
+  }
+
+  int64_t trace_count = sfile.trace_count;
+  int64_t sample_size = 0;
+  for (int64_t i = 0; i < trace_count; i++){
+    int64_t samples = liberad_get_segy_trace_samples(&sfile, sfile.map + sfile.trace_offsets[i]);
+    sample_size = (samples > sample_size) ? samples : sample_size;
+  }
+  if (trace_count == 0 || sample_size == 0 || sample_size > INT16_MAX){
+    cout << "no importable traces in segy file" << endl;
+    liberad_close_segy_file_r(&sfile);
+    return ERROR;
+  }
+
+  LiberadFile dest(LiberadFile::LIBERAD_WRITE, destination);
+  if (liberad_open_file(&dest) != SUCCESS){
+    liberad_close_segy_file_r(&sfile);
+    return ERROR;
+  }
+
+  SegyTraceHeader first;
+  decode_segy_th(sfile.map + sfile.trace_offsets[0], &first, sfile.swap);
+  bool geographic = first.coordinateUnits == SegyTraceHeader::SECONDS_ARC || first.coordinateUnits == SegyTraceHeader::DEC_DEGREES;
+
+  EradFileHeader f_header;
+  memset(&f_header, 0, sizeof(f_header));
+  f_header.hardware_version = POST2017;
+  f_header.radar_type = CUSTOM;
+  f_header.year = first.year;
+  liberad_get_date_of_day(first.year, first.day, &f_header.month, &f_header.day);
+  f_header.dimension = SINGLE_SLICE_TEMPORAL;
+  f_header.data_offset = FH_SIZE;
+  f_header.time_window = static_cast<float>(sfile.bin_header.sampleIntervalUs * 0.585);
+  f_header.sample_size = static_cast<int16_t>(sample_size);
+  f_header.coordinate_system = geographic ? GLOBAL : LOCAL;
+  f_header.dielectric_coeff = 1;
+  liberad_write_file_header(&dest, &f_header);
+
+  long int trace_size = liberad_get_trace_size(sample_size, VER_2019);
+  int64_t chunk_traces = (LIBERAD_BULK_READ_SIZE / trace_size > 0) ? LIBERAD_BULK_READ_SIZE / trace_size : 1;
+  int64_t chunk_count = (trace_count + chunk_traces - 1) / chunk_traces;
+
+  if (thread_count <= 0){
+    thread_count = thread::hardware_concurrency();
+  }
+  thread_count = (thread_count > chunk_count) ? static_cast<int>(chunk_count) : thread_count;
+  thread_count = (thread_count < 1) ? 1 : thread_count;
+
+  static const LiberadImportKernel kernel = liberad_select_import_kernel();
+  madvise(const_cast<uint8_t*>(sfile.map), sfile.map_size, MADV_SEQUENTIAL);
+  atomic<int64_t> next_chunk(0);
+  atomic<bool> error(false);
+
+  auto worker = [&](){
+    vector<uint8_t> output(chunk_traces * trace_size);
+    SegyTraceHeader t_segy;
+    EradTraceHeader t_header;
+
+    while (!error){
+      int64_t chunk = next_chunk++;
+      if (chunk >= chunk_count){
+        break;
+      }
+      int64_t first_trace = chunk * chunk_traces;
+      int64_t count = (trace_count - first_trace < chunk_traces) ? trace_count - first_trace : chunk_traces;
+
+      for (int64_t k = 0; k < count; k++){
+        int64_t i = first_trace + k;
+        uint8_t* trace = output.data() + k * trace_size;
+        const uint8_t* segy_trace = sfile.map + sfile.trace_offsets[i];
+        int64_t samples = liberad_get_segy_trace_samples(&sfile, segy_trace);
+
+        decode_segy_th(segy_trace, &t_segy, sfile.swap);
+        liberad_port_segy_erad_trace_header(&t_segy, &t_header, i);
+        t_header.sample_size = static_cast<int16_t>(sample_size);
+        encode_th_v2(&t_header, trace, false);
+
+        uint8_t* data = trace + TH_SIZE_VER_2;
+        kernel(segy_trace + SEGY_TRACE_HEADER_SIZE, data, static_cast<int>(samples), format, scale, sfile.swap);
+        memset(data + samples, 0x80, sample_size - samples);
+      }
+
+      struct iovec chunk_iov = {output.data(), static_cast<size_t>(count * trace_size)};
+      if (liberad_writev(dest.fd, &chunk_iov, 1, FH_SIZE + first_trace * trace_size) != SUCCESS){
+        cout << "could not write to erad destination" << endl;
+        error = true;
+      }
+    }
+  };
+
+  vector<thread> pool;
+  for (int i = 1; i < thread_count; i++){
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (size_t i = 0; i < pool.size(); i++){
+    pool[i].join();
+  }
+
+  if (!error){
+    uint8_t trailer[sizeof(trace_count)];
+    encode_field<int64_t>(trailer, 0, trace_count, false);
+    struct iovec trailer_iov = {trailer, sizeof(trailer)};
+    error = liberad_writev(dest.fd, &trailer_iov, 1, FH_SIZE + trace_count * trace_size) != SUCCESS;
+  }
+  liberad_close_file(&dest);
+  liberad_close_segy_file_r(&sfile);
+  return error ? ERROR : SUCCESS;
 }
 
 
-/* Writes a segy textual header to file from buffer txt_header
+/* Ports fields from a SEG-Y trace header back to an .erad trace header - the inverse of
+* liberad_port_erad_segy_bin_trace_header. Coordinates are scaled by scalarCoordinates and go to the local or the
+* geographic fields by coordinateUnits. trace_index falls back to position when the sequence numbers are unset.
 */
-void liberad_write_segy_txt_h(SegyFile* sfile, char* txt_header){
-  if (!sfile->is_open){
-    cout << "File not opened" << endl;
-    return;
+void liberad_port_segy_erad_trace_header(SegyTraceHeader* segy_t_header, EradTraceHeader* t_header, int64_t position){
+  *t_header = EradTraceHeader();
+
+  t_header->trace_index = (segy_t_header->traceSequenceNumInFile != 0) ? segy_t_header->traceSequenceNumInFile :
+                          (segy_t_header->traceSequenceNumInLine != 0) ? segy_t_header->traceSequenceNumInLine : position;
+  t_header->sample_size = segy_t_header->numSamples;
+  t_header->hour = static_cast<int8_t>(segy_t_header->hour);
+  t_header->minute = static_cast<int8_t>(segy_t_header->minute);
+  t_header->second = static_cast<int8_t>(segy_t_header->second);
+
+  double scalar = segy_t_header->scalarCoordinates;
+  scalar = (scalar < 0) ? -1 / scalar : (scalar > 0) ? scalar : 1;
+  double x = segy_t_header->groupCoordinateX * scalar;
+  double y = segy_t_header->groupCoordinateY * scalar;
+  if (segy_t_header->coordinateUnits == SegyTraceHeader::SECONDS_ARC){
+    t_header->longitude = x / 3600;
+    t_header->latitude = y / 3600;
+  } else if (segy_t_header->coordinateUnits == SegyTraceHeader::DEC_DEGREES){
+    t_header->longitude = x;
+    t_header->latitude = y;
+  } else {
+    t_header->x_local = x;
+    t_header->y_local = y;
   }
-  fseek(sfile->stream, 0, SEEK_SET);
-  fwrite(txt_header, sizeof(char), SEGY_TXT_HEADER_SIZE, sfile->stream);
 }
 
 
-// TODO write struct fields separately to avoid padding and aligning issues
-void liberad_write_segy_bin_h(SegyFile* sfile, SegyBinaryHeader* b_header){
-  if (!sfile->is_open){
-    cout << "File not opened" << endl;
-    return;
+/* Private funct. Picks the widest import kernel the CPU supports, once per process.
+*/
+LiberadImportKernel liberad_select_import_kernel(){
+#ifdef LIBERAD_HAVE_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")){
+    return liberad_import_samples_avx2;
   }
-  fseek(sfile->stream, SEGY_TXT_HEADER_SIZE - 1, SEEK_SET);
-  fwrite(b_header, SEGY_BIN_HEADER_SIZE, 1, sfile->stream);
-
+#endif
+  return liberad_import_samples_scalar;
 }
 
 
-// TODO write struct fields separately to avoid padding and aligning issues
-void liberad_write_segy_trace(SegyFile* sfile, SegyTraceHeader* t_header, const void* data, int data_size){
-  if (!sfile->is_open){
-    cout << "File not opened" << endl;
+/* Private funct. Scalar import conversion of count samples of SEG-Y format to .erad bytes: sample * scale + 128,
+* clamped to 0..255 and rounded to nearest even - BYTE_1_UNS samples are already .erad bytes and are copied. Also
+* finishes the tails of the vector kernel.
+*/
+void liberad_import_samples_scalar(const uint8_t* source, uint8_t* dest, int count, int16_t format, float scale, bool swap){
+  if (format == SegyBinaryHeader::BYTE_1_UNS){
+    memcpy(dest, source, count);
     return;
   }
+  for (int i = 0; i < count; i++){
+    float sample = 0;
+    switch (format){
+      case SegyBinaryHeader::BYTE_1_TWOS:
+        sample = static_cast<int8_t>(source[i]);
+        break;
+      case SegyBinaryHeader::BYTE_2_TWOS:
+        sample = decode_field<int16_t>(source, 2 * i, swap);
+        break;
+      case SegyBinaryHeader::BYTE_4_IEEE:
+        sample = decode_field<float>(source, 4 * i, swap);
+        break;
+      case SegyBinaryHeader::BYTE_4_IBM:
+        sample = liberad_ibm_to_float(decode_field<uint32_t>(source, 4 * i, swap));
+        break;
+    }
+    float value = fminf(fmaxf(sample * scale + 128.0f, 0.0f), 255.0f);
+    dest[i] = static_cast<uint8_t>(lrintf(value));
+  }
+}
+
 
-  fseek(sfile->stream, SEGY_TXT_HEADER_SIZE + SEGY_BIN_HEADER_SIZE - 1, SEEK_SET);
-  fwrite(t_header, SEGY_TRACE_HEADER_SIZE, 1, sfile->stream);
-  fwrite(data, data_size, 1, sfile->stream);
+#ifdef LIBERAD_HAVE_X86_SIMD
 
+/* Private funct. AVX2 import kernel - 32 samples per step: byte swap, widen or reinterpret to 4 x 8 floats, scale,
+* offset and clamp as the scalar kernel, then pack with saturation to bytes.
+*/
+__attribute__((target("avx2")))
+void liberad_import_samples_avx2(const uint8_t* source, uint8_t* dest, int count, int16_t format, float scale, bool swap){
+  if (format == SegyBinaryHeader::BYTE_1_UNS){
+    memcpy(dest, source, count);
+    return;
+  }
+  const __m256 scale_v = _mm256_set1_ps(scale);
+  const __m256 offset_v = _mm256_set1_ps(128.0f);
+  const __m256 low_v = _mm256_setzero_ps();
+  const __m256 high_v = _mm256_set1_ps(255.0f);
+  const __m128i swap16 = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+  const __m256i swap32 = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  int size = liberad_get_segy_sample_size(format);
+
+  int i = 0;
+  for (; i + 32 <= count; i += 32){
+    __m256 lanes[4];
+    for (int j = 0; j < 4; j++){
+      const uint8_t* in = source + (i + 8 * j) * size;
+      if (format == SegyBinaryHeader::BYTE_1_TWOS){
+        lanes[j] = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in))));
+      } else if (format == SegyBinaryHeader::BYTE_2_TWOS){
+        __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        raw = swap ? _mm_shuffle_epi8(raw, swap16) : raw;
+        lanes[j] = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(raw));
+      } else {
+        __m256i raw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        raw = swap ? _mm256_shuffle_epi8(raw, swap32) : raw;
+        if (format == SegyBinaryHeader::BYTE_4_IEEE){
+          lanes[j] = _mm256_castsi256_ps(raw);
+        } else {
+          // IBM: fraction * 16^(exponent - 64) * 2^-24, the power of two built as float bits 4 * exponent - 153
+          __m256 fraction = _mm256_cvtepi32_ps(_mm256_and_si256(raw, _mm256_set1_epi32(0x00FFFFFF)));
+          __m256i exponent = _mm256_and_si256(_mm256_srli_epi32(raw, 24), _mm256_set1_epi32(0x7F));
+          exponent = _mm256_sub_epi32(_mm256_slli_epi32(exponent, 2), _mm256_set1_epi32(153));
+          exponent = _mm256_min_epi32(_mm256_max_epi32(exponent, _mm256_set1_epi32(1)), _mm256_set1_epi32(254));
+          __m256 value = _mm256_mul_ps(fraction, _mm256_castsi256_ps(_mm256_slli_epi32(exponent, 23)));
+          __m256i sign = _mm256_and_si256(raw, _mm256_set1_epi32(static_cast<int>(0x80000000)));
+          lanes[j] = _mm256_or_ps(value, _mm256_castsi256_ps(sign));
+        }
+      }
+      // max first so NaN becomes 0, as fmaxf does
+      __m256 value = _mm256_add_ps(_mm256_mul_ps(lanes[j], scale_v), offset_v);
+      lanes[j] = _mm256_min_ps(_mm256_max_ps(value, low_v), high_v);
+    }
+    __m256i words_low = _mm256_packs_epi32(_mm256_cvtps_epi32(lanes[0]), _mm256_cvtps_epi32(lanes[1]));
+    __m256i words_high = _mm256_packs_epi32(_mm256_cvtps_epi32(lanes[2]), _mm256_cvtps_epi32(lanes[3]));
+    __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(words_low, words_high), order);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), bytes);
+  }
+  liberad_import_samples_scalar(source + i * size, dest + i, count - i, format, scale, swap);
 }
 
+#endif
+
 
-/* Closes a SegyFile's stream instance.
+/* Private funct. Converts day of year (1 based) of year to its month and day of month
 */
-void liberad_close_segy_file_w(SegyFile* sfile){
-  if (sfile->is_open){
-    fclose(sfile->stream);
-    sfile->is_open = false;
-    sfile->stream = nullptr;
+void liberad_get_date_of_day(int year, int day_of_year, int16_t* month, int16_t* day){
+  static const int days_in_month[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+  int m = 0;
+  day_of_year = (day_of_year < 1) ? 1 : day_of_year;
+  while (m < 11 && day_of_year > days_in_month[m] + ((m == 1 && leap) ? 1 : 0)){
+    day_of_year -= days_in_month[m] + ((m == 1 && leap) ? 1 : 0);
+    m++;
   }
+  *month = static_cast<int16_t>(m + 1);
+  *day = static_cast<int16_t>(day_of_year);
+}
+
+
+/* Private funct. Converts month and day of month of year to day of year (1 based)
+*/
+int liberad_get_day_of_year(int year, int month, int day){
+  static const int days_before_month[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+  month = (month < 1) ? 1 : (month > 12) ? 12 : month;
+  return days_before_month[month - 1] + day + ((leap && month > 2) ? 1 : 0);
 }
 
 
@@ -618,6 +3992,19 @@ long int liberad_get_trace_data_index_at(int64_t trace_index, int sample_size, i
 }
 
 
+/* Calculates and returns the size in bytes of a single trace on disk - trace header plus data samples
+*/
+long int liberad_get_trace_size(int sample_size, int8_t file_version){
+
+  if (file_version == VER_2018){
+    return TH_SIZE_VER_1 + sample_size;
+  } else {
+    return TH_SIZE_VER_2 + sample_size;
+  }
+
+}
+
+
 /* Calcultes and returns the location of the first byte of a trace header with trace_index(as in first, second or 33th trace)
 */
 long int liberad_get_trace_header_index_at(int64_t trace_index, int sample_size, int8_t file_version){
@@ -662,21 +4049,124 @@ void liberad_port_trace_header_data(EradTraceHeader_VER_1* source, EradTraceHead
 */
 void liberad_read_trace_header(LiberadFile* efile, long int index_file, EradTraceHeader* t_header){
 
-  fseek(efile->stream, index_file, SEEK_SET);
+  int th_size = (efile->file_ver < VER_2019) ? TH_SIZE_VER_1 : TH_SIZE_VER_2;
+  uint8_t raw[TH_SIZE_VER_2];
+
+  if (liberad_read_at(efile, index_file, raw, th_size) == SUCCESS){
+    liberad_decode_trace_header(efile, raw, t_header);
+  }
+}
+
+
+/* Private funct. Reads size bytes at byte offset of efile into buffer. Memory copy in mmap mode, a single pread in
+* LIBERAD_READ_POSITIONAL mode (no shared file position) and fseek + fread otherwise.
+*/
+int liberad_read_at(LiberadFile* efile, long int offset, uint8_t* buffer, long int size){
+  if (efile->map != nullptr){
+    if (offset < 0 || offset + size > efile->map_size){
+      return ERROR;
+    }
+    memcpy(buffer, efile->map + offset, size);
+    return SUCCESS;
+  }
+
+  if (efile->mode == LiberadFile::LIBERAD_READ_POSITIONAL){
+    return liberad_pread(efile->fd, buffer, size, offset);
+  }
+
+  fseek(efile->stream, offset, SEEK_SET);
+  return (fread(buffer, 1, size, efile->stream) == static_cast<size_t>(size)) ? SUCCESS : ERROR;
+}
+
+
+/* Private funct. Reads exactly size bytes at byte offset of file descriptor fd into buffer, retrying short reads.
+*/
+int liberad_pread(int fd, uint8_t* buffer, long int size, long int offset){
+  long int done = 0;
+  while (done < size){
+    ssize_t count = pread(fd, buffer + done, size - done, offset + done);
+    if (count < 0 && errno == EINTR){
+      continue;
+    }
+    if (count <= 0){
+      return ERROR;
+    }
+    done += count;
+  }
+  return SUCCESS;
+}
+
+
+/* Private funct. Reads the raw on-disk header (th_raw) and/or samples (data) of the trace at trace_index. Either pointer
+* may be nullptr to skip that part. In LIBERAD_READ_POSITIONAL mode header and samples are read with a single preadv.
+*/
+int liberad_read_trace(LiberadFile* efile, int64_t trace_index, uint8_t* th_raw, uint8_t* data){
+  int sample_size = efile->f_header->sample_size;
+  long int th_size = liberad_get_trace_size(sample_size, efile->file_ver) - sample_size;
+  long int index = liberad_get_trace_header_index_at(trace_index, sample_size, efile->file_ver);
+  int result = ERROR;
+
+  if (efile->cache != nullptr && liberad_cache_read(efile, trace_index, th_raw, data)){
+    return SUCCESS;
+  }
+  if (efile->prefetcher != nullptr && liberad_prefetch_read(efile->prefetcher, trace_index, th_raw, data)){
+    return SUCCESS;
+  }
+
+  if (trace_index < 0){
+    result = ERROR;
+  } else if (efile->blocks != nullptr){
+    lock_guard<mutex> lock(efile->blocks->mutex);
+    int64_t block = trace_index / efile->blocks->block_traces;
+    const uint8_t* traces = (trace_index < efile->trace_count) ? liberad_decode_block_at(efile, block) : nullptr;
+    if (traces != nullptr){
+      const uint8_t* trace = traces + (trace_index - block * efile->blocks->block_traces) * (th_size + sample_size);
+      if (th_raw != nullptr){
+        memcpy(th_raw, trace, th_size);
+      }
+      if (data != nullptr){
+        memcpy(data, trace + th_size, sample_size);
+      }
+      result = SUCCESS;
+    }
+  } else if (th_raw == nullptr){
+    result = liberad_read_at(efile, index + th_size, data, sample_size);
+  } else if (data == nullptr){
+    result = liberad_read_at(efile, index, th_raw, th_size);
+  } else if (efile->mode == LiberadFile::LIBERAD_READ_POSITIONAL){
+    struct iovec iov[2] = {{th_raw, static_cast<size_t>(th_size)}, {data, static_cast<size_t>(sample_size)}};
+    result = (preadv(efile->fd, iov, 2, index) == th_size + sample_size) ? SUCCESS : ERROR;
+  } else if (efile->map != nullptr){
+    result = liberad_read_at(efile, index, th_raw, th_size);
+    if (result == SUCCESS){
+      result = liberad_read_at(efile, index + th_size, data, sample_size);
+    }
+  } else {
+    fseek(efile->stream, index, SEEK_SET);
+    bool ok = fread(th_raw, th_size, 1, efile->stream) == 1;
+    result = (ok && fread(data, sample_size, 1, efile->stream) == 1) ? SUCCESS : ERROR;
+  }
+
+  if (result != SUCCESS){
+    cout << "could not read trace " << trace_index << endl;
+  }
+  return result;
+}
+
+
+/* Decodes a packed on-disk trace header of efile's version and endianness into t_header
+*/
+void liberad_decode_trace_header(LiberadFile* efile, const uint8_t* raw, EradTraceHeader* t_header){
+
+  bool swap = efile->endianness != system_endianness;
 
   if (efile->file_ver < VER_2019){
     EradTraceHeader_VER_1 th;
-    read_th_v1(efile->stream, &th);
-    if (efile->endianness != system_endianness){
-      liberad_shift_trace_header_ver1_endianness(&th);
-    }
+    decode_th_v1(raw, &th, swap);
     liberad_port_trace_header_data(&th, t_header);
 
   } else {
-    read_th_v2(efile->stream, t_header);
-    if (efile->endianness != system_endianness){
-      liberad_shift_trace_header_ver2_endianness(t_header);
-    }
+    decode_th_v2(raw, t_header, swap);
   }
 }
 
@@ -685,169 +4175,802 @@ void liberad_read_trace_header(LiberadFile* efile, long int index_file, EradTrac
 * endianness
 */
 EndiannessMarker liberad_read_file_header(FILE* stream, EradFileHeader* f_header, int8_t file_ver){
+  uint8_t buffer[FH_SIZE];
   fseek(stream, 0, SEEK_SET);
-  read_fh(stream, f_header);
+  fread(buffer, FH_SIZE, 1, stream);
 
-  if (file_ver < liberad::VER_2019){
-    fseek(stream, 38, SEEK_SET);
-    int16_t temp;
-    fread(&temp, sizeof(int16_t), 1, stream);
+  EndiannessMarker endianness = liberad_get_file_endianness(reinterpret_cast<int8_t*>(buffer + 9));
+  bool swap = endianness != system_endianness;
+  decode_fh(buffer, f_header, swap);
 
-    f_header->steps_per_meter = static_cast<uint8_t>(temp);
+  if (file_ver < liberad::VER_2019){
+    f_header->steps_per_meter = static_cast<uint8_t>(decode_field<int16_t>(buffer, 38, swap));
     f_header->coordinate_system = LOCAL;
   }
 
-  EndiannessMarker endianness = liberad_get_file_endianness(f_header->endianness_marker);
-  if (endianness != system_endianness){
-    liberad_shift_file_header_endianness(f_header);
-  }
-
   return endianness;
 }
 
 
-/* Private funct. Reads data from file into an EradTraceHeader instance's fields. This preferred to a bulk
-* fread(&th, TH_SIZE_VER_1, 1, stream) because of memory padding and alignment on different systems. Presumes an
-* opened stream and a stream pointer previoiusly set to exact point in file (with fseek)
+/* -------------------------------Header codec---------------------------------------------------------------- */
+
+/* Private funct. Decodes a single field of type T stored at offset of a packed on-disk header. memcpy avoids unaligned
+* access and swap folds the endianness shift into the decode.
 */
-void read_th_v1(FILE* stream, EradTraceHeader_VER_1* th){
+template<typename T>
+T decode_field(const uint8_t* buffer, int offset, bool swap){
+  T value;
+  memcpy(&value, buffer + offset, sizeof(T));
+  return swap ? shift_endianness<T>(value) : value;
+}
 
-    fread(&th->trace_index, sizeof(th->trace_index), 1, stream);
-    fread(&th->sample_size, sizeof(th->sample_size), 1, stream);
-    fread(&th->steps_per_trace, sizeof(th->steps_per_trace), 1, stream);
-    fread(&th->hour, sizeof(th->hour), 1, stream);
-    fread(&th->minute, sizeof(th->minute), 1, stream);
-    fread(&th->second, sizeof(th->second), 1, stream);
-    fread(&th->millisecond, sizeof(th->millisecond), 1, stream);
-    fread(&th->fold_index, sizeof(th->fold_index), 1, stream);
-    fread(&th->fold_orientation, sizeof(th->fold_orientation), 1, stream);
-    fread(&th->trace_index_in_fold, sizeof(th->trace_index_in_fold), 1, stream);
-    fread(&th->x_local, sizeof(th->x_local), 1, stream);
-    fread(&th->y_local, sizeof(th->y_local), 1, stream);
-    fread(&th->z_local, sizeof(th->z_local), 1, stream);
+
+/* Private funct. Decodes a packed TH_SIZE_VER_1 byte trace header into an EradTraceHeader_VER_1 instance's fields.
+* This preferred to a bulk memcpy because of memory padding and alignment on different systems.
+*/
+void decode_th_v1(const uint8_t* buffer, EradTraceHeader_VER_1* th, bool swap){
+
+    th->trace_index = decode_field<int64_t>(buffer, 0, swap);
+    th->sample_size = decode_field<int16_t>(buffer, 8, swap);
+    th->steps_per_trace = decode_field<int16_t>(buffer, 10, swap);
+    th->hour = decode_field<int16_t>(buffer, 12, swap);
+    th->minute = decode_field<int16_t>(buffer, 14, swap);
+    th->second = decode_field<int16_t>(buffer, 16, swap);
+    th->millisecond = decode_field<int32_t>(buffer, 18, swap);
+    th->fold_index = decode_field<int32_t>(buffer, 22, swap);
+    th->fold_orientation = decode_field<int8_t>(buffer, 26, false);
+    th->trace_index_in_fold = decode_field<int32_t>(buffer, 27, swap);
+    th->x_local = decode_field<double>(buffer, 31, swap);
+    th->y_local = decode_field<double>(buffer, 39, swap);
+    th->z_local = decode_field<double>(buffer, 47, swap);
 
 }
 
 
-/* Private funct. Reads data from file into an EradTraceHeader instance's fields. This preferred to a bulk
-* fread(&th, TH_SIZE_VER_2, 1, stream) because of memory padding and alignment on different systems. Presumes an
-* opened stream and a stream pointer previoiusly set to exact point in file (with fseek)
+/* Private funct. Decodes a packed TH_SIZE_VER_2 byte trace header into an EradTraceHeader instance's fields at the
+* offsets documented in README.md
 */
-void read_th_v2(FILE* stream, EradTraceHeader* th){
+void decode_th_v2(const uint8_t* buffer, EradTraceHeader* th, bool swap){
+
+    th->trace_index = decode_field<int64_t>(buffer, 0, swap);
+    th->sample_size = decode_field<int16_t>(buffer, 8, swap);
+    th->steps_per_trace = decode_field<int16_t>(buffer, 10, swap);
+    th->hour = decode_field<int8_t>(buffer, 12, false);
+    th->minute = decode_field<int8_t>(buffer, 13, false);
+    th->second = decode_field<int8_t>(buffer, 14, false);
+    th->millisecond = decode_field<int16_t>(buffer, 15, swap);
+    th->fold_index = decode_field<int32_t>(buffer, 17, swap);
+    th->fold_orientation = decode_field<int8_t>(buffer, 21, false);
+    th->trace_index_in_fold = decode_field<int32_t>(buffer, 22, swap);
+    th->x_local = decode_field<double>(buffer, 26, swap);
+    th->y_local = decode_field<double>(buffer, 34, swap);
+    th->z_local = decode_field<double>(buffer, 42, swap);
+    th->longitude = decode_field<double>(buffer, 50, swap);
+    th->latitude = decode_field<double>(buffer, 58, swap);
 
-    fread(&th->trace_index, sizeof(th->trace_index), 1, stream);
-    fread(&th->sample_size, sizeof(th->sample_size), 1, stream);
-    fread(&th->steps_per_trace, sizeof(th->steps_per_trace), 1, stream);
-    fread(&th->hour, sizeof(th->hour), 1, stream);
-    fread(&th->minute, sizeof(th->minute), 1, stream);
-    fread(&th->second, sizeof(th->second), 1, stream);
-    fread(&th->millisecond, sizeof(th->millisecond), 1, stream);
-    fread(&th->fold_index, sizeof(th->fold_index), 1, stream);
-    fread(&th->fold_orientation, sizeof(th->fold_orientation), 1, stream);
-    fread(&th->trace_index_in_fold, sizeof(th->trace_index_in_fold), 1, stream);
-    fread(&th->x_local, sizeof(th->x_local), 1, stream);
-    fread(&th->y_local, sizeof(th->y_local), 1, stream);
-    fread(&th->z_local, sizeof(th->z_local), 1, stream);
-    fread(&th->longitude, sizeof(th->longitude), 1, stream);
-    fread(&th->latitude, sizeof(th->latitude), 1, stream);
+}
+
+
+/* Private funct. Decodes a packed FH_SIZE byte file header into an EradFileHeader instance's fields at the offsets
+* documented in README.md
+*/
+void decode_fh(const uint8_t* buffer, EradFileHeader* fh, bool swap){
+
+    memcpy(fh->magic_num, buffer, 8);
+    fh->file_version = decode_field<int8_t>(buffer, 8, false);
+    memcpy(fh->endianness_marker, buffer + 9, 2);
+    fh->hardware_version = decode_field<int8_t>(buffer, 11, false);
+    fh->radar_type = decode_field<int16_t>(buffer, 12, swap);
+    fh->year = decode_field<int16_t>(buffer, 14, swap);
+    fh->month = decode_field<int16_t>(buffer, 16, swap);
+    fh->day = decode_field<int16_t>(buffer, 18, swap);
+    fh->dimension = decode_field<int16_t>(buffer, 20, swap);
+    fh->data_offset = decode_field<int16_t>(buffer, 22, swap);
+    fh->time_window = decode_field<float>(buffer, 24, swap);
+    fh->total_x = decode_field<float>(buffer, 28, swap);
+    fh->total_y = decode_field<float>(buffer, 32, swap);
+    fh->sample_size = decode_field<int16_t>(buffer, 36, swap);
+    fh->steps_per_meter = decode_field<uint8_t>(buffer, 38, false);
+    fh->coordinate_system = decode_field<int8_t>(buffer, 39, false);
+    fh->dielectric_coeff = decode_field<float>(buffer, 40, swap);
+    fh->interval_x = decode_field<float>(buffer, 44, swap);
+    fh->interval_y = decode_field<float>(buffer, 48, swap);
+    memcpy(fh->scan_operator, buffer + 52, 58);
+    memcpy(fh->location, buffer + 110, 102);
 
 }
 
 
-/* Private funct. Reads data from file into an EradFileHeader instance's fields. This preferred to a bulk
-* fread(&fh, FH_SIZE, 1, stream) because of memory padding and alignment on different systems. Presumes an
-* opened stream and a stream pointer previoiusly set to exact point in file (with fseek)
+/* Private funct. Encodes value of type T at offset of a packed on-disk header, shifting its endianness if swap is set.
 */
-void read_fh(FILE* stream, EradFileHeader* fh){
+template<typename T>
+void encode_field(uint8_t* buffer, int offset, T value, bool swap){
+  if (swap){
+    value = shift_endianness<T>(value);
+  }
+  memcpy(buffer + offset, &value, sizeof(T));
+}
 
-    fread(&fh->magic_num , sizeof(int8_t), 8, stream);
-    fread(&fh->file_version , sizeof(fh->file_version), 1, stream);
-    fread(&fh->endianness_marker , sizeof(int8_t), 2, stream);
-    fread(&fh->hardware_version , sizeof(fh->hardware_version), 1, stream);
-    fread(&fh->radar_type , sizeof(fh->radar_type), 1, stream);
-    fread(&fh->year , sizeof(fh->year), 1, stream);
-    fread(&fh->month , sizeof(fh->month), 1, stream);
-    fread(&fh->day , sizeof(fh->day), 1, stream);
-    fread(&fh->dimension , sizeof(fh->dimension), 1, stream);
-    fread(&fh->data_offset , sizeof(fh->data_offset), 1, stream);
-    fread(&fh->time_window , sizeof(fh->time_window), 1, stream);
-    fread(&fh->total_x , sizeof(fh->total_x), 1, stream);
-    fread(&fh->total_y , sizeof(fh->total_y), 1, stream);
-    fread(&fh->sample_size , sizeof(fh->sample_size), 1, stream);
-    fread(&fh->steps_per_meter , sizeof(fh->steps_per_meter), 1, stream);
-    fread(&fh->coordinate_system , sizeof(fh->coordinate_system), 1, stream);
-    fread(&fh->dielectric_coeff , sizeof(fh->dielectric_coeff), 1, stream);
-    fread(&fh->interval_x , sizeof(fh->interval_x), 1, stream);
-    fread(&fh->interval_y , sizeof(fh->interval_y), 1, stream);
-    fread(&fh->scan_operator , sizeof(char), 58, stream);
-    fread(&fh->location , sizeof(char), 102, stream);
+
+/* Private funct. Encodes an EradTraceHeader instance's fields into a packed TH_SIZE_VER_2 byte on-disk trace header.
+* This preferred to a bulk memcpy because of memory padding and alignment on different systems.
+*/
+void encode_th_v2(const EradTraceHeader* th, uint8_t* buffer, bool swap){
+
+    encode_field<int64_t>(buffer, 0, th->trace_index, swap);
+    encode_field<int16_t>(buffer, 8, th->sample_size, swap);
+    encode_field<int16_t>(buffer, 10, th->steps_per_trace, swap);
+    encode_field<int8_t>(buffer, 12, th->hour, false);
+    encode_field<int8_t>(buffer, 13, th->minute, false);
+    encode_field<int8_t>(buffer, 14, th->second, false);
+    encode_field<int16_t>(buffer, 15, th->millisecond, swap);
+    encode_field<int32_t>(buffer, 17, th->fold_index, swap);
+    encode_field<int8_t>(buffer, 21, th->fold_orientation, false);
+    encode_field<int32_t>(buffer, 22, th->trace_index_in_fold, swap);
+    encode_field<double>(buffer, 26, th->x_local, swap);
+    encode_field<double>(buffer, 34, th->y_local, swap);
+    encode_field<double>(buffer, 42, th->z_local, swap);
+    encode_field<double>(buffer, 50, th->longitude, swap);
+    encode_field<double>(buffer, 58, th->latitude, swap);
 
 }
 
 
-/* -----------------------------Endianness helper functs--------------------------------------------------------------- */
+/* Private funct. Encodes an EradFileHeader instance's fields into a packed FH_SIZE byte on-disk file header.
+*/
+void encode_fh(const EradFileHeader* fh, uint8_t* buffer, bool swap){
+
+    memcpy(buffer, fh->magic_num, 8);
+    encode_field<int8_t>(buffer, 8, fh->file_version, false);
+    memcpy(buffer + 9, fh->endianness_marker, 2);
+    encode_field<int8_t>(buffer, 11, fh->hardware_version, false);
+    encode_field<int16_t>(buffer, 12, fh->radar_type, swap);
+    encode_field<int16_t>(buffer, 14, fh->year, swap);
+    encode_field<int16_t>(buffer, 16, fh->month, swap);
+    encode_field<int16_t>(buffer, 18, fh->day, swap);
+    encode_field<int16_t>(buffer, 20, fh->dimension, swap);
+    encode_field<int16_t>(buffer, 22, fh->data_offset, swap);
+    encode_field<float>(buffer, 24, fh->time_window, swap);
+    encode_field<float>(buffer, 28, fh->total_x, swap);
+    encode_field<float>(buffer, 32, fh->total_y, swap);
+    encode_field<int16_t>(buffer, 36, fh->sample_size, swap);
+    encode_field<uint8_t>(buffer, 38, fh->steps_per_meter, false);
+    encode_field<int8_t>(buffer, 39, fh->coordinate_system, false);
+    encode_field<float>(buffer, 40, fh->dielectric_coeff, swap);
+    encode_field<float>(buffer, 44, fh->interval_x, swap);
+    encode_field<float>(buffer, 48, fh->interval_y, swap);
+    memcpy(buffer + 52, fh->scan_operator, 58);
+    memcpy(buffer + 110, fh->location, 102);
+
+}
+
+
+/* -------------------------------Segy header codec----------------------------------------------------------- */
+
+/* Private funct. Encodes a SegyBinaryHeader instance's fields into the packed SEGY_BIN_HEADER_SIZE byte big-endian
+* binary header of the SEG-Y standard. Unassigned bytes are zeroed.
+*/
+void encode_segy_bh(const SegyBinaryHeader* bh, uint8_t* buffer){
+    bool swap = liberad_get_system_endianness() != BIG_END;
+    memset(buffer, 0, SEGY_BIN_HEADER_SIZE);
+
+    encode_field<int32_t>(buffer, 0, bh->jobID, swap);
+    encode_field<int32_t>(buffer, 4, bh->lineNum, swap);
+    encode_field<int32_t>(buffer, 8, bh->reelNum, swap);
+    encode_field<int16_t>(buffer, 12, bh->dataTracesPerEnsemble, swap);
+    encode_field<int16_t>(buffer, 14, bh->auxiliaryTracesPerEnsemble, swap);
+    encode_field<int16_t>(buffer, 16, bh->sampleIntervalUs, swap);
+    encode_field<int16_t>(buffer, 18, bh->sampleIntervalUsOriginal, swap);
+    encode_field<int16_t>(buffer, 20, bh->samplesPerDataTrace, swap);
+    encode_field<int16_t>(buffer, 22, bh->samplesPerDataTraceOriginal, swap);
+    encode_field<int16_t>(buffer, 24, bh->formatCode, swap);
+    encode_field<int16_t>(buffer, 26, bh->ensembleFold, swap);
+    encode_field<int16_t>(buffer, 28, bh->traceSortingCode, swap);
+    encode_field<int16_t>(buffer, 30, bh->verticalSum, swap);
+    encode_field<int16_t>(buffer, 32, bh->sweepFreqStart, swap);
+    encode_field<int16_t>(buffer, 34, bh->sweepFreqEnd, swap);
+    encode_field<int16_t>(buffer, 36, bh->sweepLength, swap);
+    encode_field<int16_t>(buffer, 38, bh->sweepTypeCode, swap);
+    encode_field<int16_t>(buffer, 40, bh->traceNumSweepChannel, swap);
+    encode_field<int16_t>(buffer, 42, bh->sweepTaperLengthStart, swap);
+    encode_field<int16_t>(buffer, 44, bh->sweepTaperLengthEnd, swap);
+    encode_field<int16_t>(buffer, 46, bh->taperType, swap);
+    encode_field<int16_t>(buffer, 48, bh->correlatedData, swap);
+    encode_field<int16_t>(buffer, 50, bh->binaryGain, swap);
+    encode_field<int16_t>(buffer, 52, bh->amplitudeRecoverMethod, swap);
+    encode_field<int16_t>(buffer, 54, bh->measurementSys, swap);
+    encode_field<int16_t>(buffer, 56, bh->impulseSignalPolarity, swap);
+    encode_field<int16_t>(buffer, 58, bh->vibratoryPolarityCode, swap);
+    encode_field<int32_t>(buffer, 60, bh->extendedNumDataTraces, swap);
+    encode_field<int32_t>(buffer, 64, bh->extendedNumAuxTraces, swap);
+    encode_field<int32_t>(buffer, 68, bh->extendedNumSamplesPerEnsemble, swap);
+    encode_field<int64_t>(buffer, 72, bh->extendedSampleInterval, swap);
+    encode_field<int64_t>(buffer, 80, bh->extendedSampleIntervalOriginal, swap);
+    encode_field<int32_t>(buffer, 88, bh->extendedNumSamplesPerTrace, swap);
+    encode_field<int32_t>(buffer, 92, bh->extendedEnsembleFold, swap);
+    encode_field<int32_t>(buffer, 96, bh->integerConstant, swap);
+    encode_field<int8_t>(buffer, 300, bh->majorRevNum, false);
+    encode_field<int8_t>(buffer, 301, bh->minorRevNum, false);
+    encode_field<int16_t>(buffer, 302, bh->fixedLengthTrace, swap);
+    encode_field<int16_t>(buffer, 304, bh->numExtendedTextHeaders, swap);
+    encode_field<int32_t>(buffer, 306, bh->maxNumAdditionalTraceHeaders, swap);
+    encode_field<int16_t>(buffer, 310, bh->timeBasisCode, swap);
+    encode_field<int64_t>(buffer, 312, bh->numOfTracesInFile, swap);
+    encode_field<int64_t>(buffer, 320, bh->offsetFirstTrace, swap);
+    encode_field<int32_t>(buffer, 328, bh->numTrailerStanzaRecs, swap);
+
+}
+
+
+/* Private funct. Encodes a SegyTraceHeader instance's fields into the packed SEGY_TRACE_HEADER_SIZE byte big-endian
+* trace header of the SEG-Y standard. Unassigned bytes are zeroed.
+*/
+void encode_segy_th(const SegyTraceHeader* th, uint8_t* buffer){
+    bool swap = liberad_get_system_endianness() != BIG_END;
+
+    encode_field<int32_t>(buffer, 0, th->traceSequenceNumInLine, swap);
+    encode_field<int32_t>(buffer, 4, th->traceSequenceNumInFile, swap);
+    encode_field<int32_t>(buffer, 8, th->originalRecordNum, swap);
+    encode_field<int32_t>(buffer, 12, th->traceNumInOriginalRecord, swap);
+    encode_field<int32_t>(buffer, 16, th->energySourcePoint, swap);
+    encode_field<int32_t>(buffer, 20, th->ensembleNum, swap);
+    encode_field<int32_t>(buffer, 24, th->traceNumInEnsemble, swap);
+    encode_field<int16_t>(buffer, 28, th->traceIdCode, swap);
+    encode_field<int16_t>(buffer, 30, th->verticallySummedTraces, swap);
+    encode_field<int16_t>(buffer, 32, th->horizontallySummedTraces, swap);
+    encode_field<int16_t>(buffer, 34, th->dataUse, swap);
+    encode_field<int32_t>(buffer, 36, th->distanceFromCenter, swap);
+    encode_field<int32_t>(buffer, 40, th->receiverElevation, swap);
+    encode_field<int32_t>(buffer, 44, th->surfaceElevation, swap);
+    encode_field<int32_t>(buffer, 48, th->sourceDepth, swap);
+    encode_field<int32_t>(buffer, 52, th->datumElevationReceiver, swap);
+    encode_field<int32_t>(buffer, 56, th->datumElevationSource, swap);
+    encode_field<int32_t>(buffer, 60, th->waterDepthSource, swap);
+    encode_field<int32_t>(buffer, 64, th->waterDepthGroup, swap);
+    encode_field<int16_t>(buffer, 68, th->scalar, swap);
+    encode_field<int16_t>(buffer, 70, th->scalarCoordinates, swap);
+    encode_field<int32_t>(buffer, 72, th->sourceCoordinateX, swap);
+    encode_field<int32_t>(buffer, 76, th->sourceCoordinateY, swap);
+    encode_field<int32_t>(buffer, 80, th->groupCoordinateX, swap);
+    encode_field<int32_t>(buffer, 84, th->groupCoordinateY, swap);
+    encode_field<int16_t>(buffer, 88, th->coordinateUnits, swap);
+    encode_field<int16_t>(buffer, 90, th->weatheringVelocity, swap);
+    encode_field<int16_t>(buffer, 92, th->subweatheringVelocity, swap);
+    encode_field<int16_t>(buffer, 94, th->upholeTimeSource, swap);
+    encode_field<int16_t>(buffer, 96, th->upholeTimeGroup, swap);
+    encode_field<int16_t>(buffer, 98, th->sourceStaticCorrection, swap);
+    encode_field<int16_t>(buffer, 100, th->groupStaticCorrection, swap);
+    encode_field<int16_t>(buffer, 102, th->totalStaticApplied, swap);
+    encode_field<int16_t>(buffer, 104, th->lagTimeA, swap);
+    encode_field<int16_t>(buffer, 106, th->lagTimeB, swap);
+    encode_field<int16_t>(buffer, 108, th->delay, swap);
+    encode_field<int16_t>(buffer, 110, th->muteTimeStart, swap);
+    encode_field<int16_t>(buffer, 112, th->muteTimeEnd, swap);
+    encode_field<int16_t>(buffer, 114, th->numSamples, swap);
+    encode_field<int16_t>(buffer, 116, th->sampleInterval, swap);
+    encode_field<int16_t>(buffer, 118, th->gainType, swap);
+    encode_field<int16_t>(buffer, 120, th->instrumentGainConstant, swap);
+    encode_field<int16_t>(buffer, 122, th->instrumentInitialGain, swap);
+    encode_field<int16_t>(buffer, 124, th->correlated, swap);
+    encode_field<int16_t>(buffer, 126, th->sweepFreqStart, swap);
+    encode_field<int16_t>(buffer, 128, th->sweepFreqEnd, swap);
+    encode_field<int16_t>(buffer, 130, th->sweepLength, swap);
+    encode_field<int16_t>(buffer, 132, th->sweepType, swap);
+    encode_field<int16_t>(buffer, 134, th->sweepTraceLenghtStart, swap);
+    encode_field<int16_t>(buffer, 136, th->sweepTraceLengthEnd, swap);
+    encode_field<int16_t>(buffer, 138, th->taperType, swap);
+    encode_field<int16_t>(buffer, 140, th->aliasFilterFreq, swap);
+    encode_field<int16_t>(buffer, 142, th->aliasFilterSlope, swap);
+    encode_field<int16_t>(buffer, 144, th->notchFilterFreq, swap);
+    encode_field<int16_t>(buffer, 146, th->notchFilterSlope, swap);
+    encode_field<int16_t>(buffer, 148, th->lowCutFreq, swap);
+    encode_field<int16_t>(buffer, 150, th->highCutFreq, swap);
+    encode_field<int16_t>(buffer, 152, th->lowCutSlope, swap);
+    encode_field<int16_t>(buffer, 154, th->highCutSlope, swap);
+    encode_field<int16_t>(buffer, 156, th->year, swap);
+    encode_field<int16_t>(buffer, 158, th->day, swap);
+    encode_field<int16_t>(buffer, 160, th->hour, swap);
+    encode_field<int16_t>(buffer, 162, th->minute, swap);
+    encode_field<int16_t>(buffer, 164, th->second, swap);
+    encode_field<int16_t>(buffer, 166, th->timeBasisCode, swap);
+    encode_field<int16_t>(buffer, 168, th->traceWeightFactor, swap);
+    encode_field<int16_t>(buffer, 170, th->geophoneRollSwitch, swap);
+    encode_field<int16_t>(buffer, 172, th->geophoneTraceFirst, swap);
+    encode_field<int16_t>(buffer, 174, th->geophoneTraceLast, swap);
+    encode_field<int16_t>(buffer, 176, th->gapSize, swap);
+    encode_field<int16_t>(buffer, 178, th->overTravel, swap);
+    encode_field<int32_t>(buffer, 180, th->ensembleX, swap);
+    encode_field<int32_t>(buffer, 184, th->ensembleY, swap);
+    encode_field<int32_t>(buffer, 188, th->inLineNum, swap);
+    encode_field<int32_t>(buffer, 192, th->crossLineNum, swap);
+    encode_field<int32_t>(buffer, 196, th->shotPoint, swap);
+    encode_field<int16_t>(buffer, 200, th->scalarToShotPoint, swap);
+    encode_field<int16_t>(buffer, 202, th->traceMeasurementUnit, swap);
+    encode_field<int32_t>(buffer, 204, th->transductionMantissa, swap);
+    encode_field<int16_t>(buffer, 208, th->transductionPower, swap);
+    encode_field<int16_t>(buffer, 210, th->transductionUnits, swap);
+    encode_field<int16_t>(buffer, 212, th->deviceId, swap);
+    encode_field<int16_t>(buffer, 214, th->scalarTimes, swap);
+    encode_field<int16_t>(buffer, 216, th->sourceOrientation, swap);
+    encode_field<int32_t>(buffer, 218, th->sourceEnergyDirectioneMantissa, swap);
+    encode_field<int16_t>(buffer, 222, th->sourceEnergyDirectionPower, swap);
+    encode_field<int32_t>(buffer, 224, th->sourceMeasurementMantissa, swap);
+    encode_field<int16_t>(buffer, 228, th->sourceMeasurementExponent, swap);
+    encode_field<int16_t>(buffer, 230, th->sourceMeasurementUnit, swap);
+    memset(buffer + 232, 0, 8);
+
+}
+
+
+/* Private funct. Re-encodes only the fields liberad_port_erad_segy_bin_trace_header sets per trace into buffer, a trace
+* header encoded once with encode_segy_th as a template - the constant fields are left untouched.
+*/
+void patch_segy_th(const SegyTraceHeader* th, uint8_t* buffer){
+    bool swap = liberad_get_system_endianness() != BIG_END;
+
+    encode_field<int32_t>(buffer, 0, th->traceSequenceNumInLine, swap);
+    encode_field<int32_t>(buffer, 4, th->traceSequenceNumInFile, swap);
+    encode_field<int32_t>(buffer, 8, th->originalRecordNum, swap);
+    encode_field<int32_t>(buffer, 20, th->ensembleNum, swap);
+    encode_field<int16_t>(buffer, 70, th->scalarCoordinates, swap);
+    encode_field<int32_t>(buffer, 72, th->sourceCoordinateX, swap);
+    encode_field<int32_t>(buffer, 76, th->sourceCoordinateY, swap);
+    encode_field<int32_t>(buffer, 80, th->groupCoordinateX, swap);
+    encode_field<int32_t>(buffer, 84, th->groupCoordinateY, swap);
+    encode_field<int16_t>(buffer, 114, th->numSamples, swap);
+    encode_field<int16_t>(buffer, 160, th->hour, swap);
+    encode_field<int16_t>(buffer, 162, th->minute, swap);
+    encode_field<int16_t>(buffer, 164, th->second, swap);
+
+}
 
 
-/* Shifts a file header's endianness.
+/* Private funct. Decodes a packed SEGY_BIN_HEADER_SIZE byte binary header into a SegyBinaryHeader instance's fields.
+* Unassigned bytes are copied as they are.
 */
-void liberad_shift_file_header_endianness(EradFileHeader* f_header){
+void decode_segy_bh(const uint8_t* buffer, SegyBinaryHeader* bh, bool swap){
+
+    bh->jobID = decode_field<int32_t>(buffer, 0, swap);
+    bh->lineNum = decode_field<int32_t>(buffer, 4, swap);
+    bh->reelNum = decode_field<int32_t>(buffer, 8, swap);
+    bh->dataTracesPerEnsemble = decode_field<int16_t>(buffer, 12, swap);
+    bh->auxiliaryTracesPerEnsemble = decode_field<int16_t>(buffer, 14, swap);
+    bh->sampleIntervalUs = decode_field<int16_t>(buffer, 16, swap);
+    bh->sampleIntervalUsOriginal = decode_field<int16_t>(buffer, 18, swap);
+    bh->samplesPerDataTrace = decode_field<int16_t>(buffer, 20, swap);
+    bh->samplesPerDataTraceOriginal = decode_field<int16_t>(buffer, 22, swap);
+    bh->formatCode = decode_field<int16_t>(buffer, 24, swap);
+    bh->ensembleFold = decode_field<int16_t>(buffer, 26, swap);
+    bh->traceSortingCode = decode_field<int16_t>(buffer, 28, swap);
+    bh->verticalSum = decode_field<int16_t>(buffer, 30, swap);
+    bh->sweepFreqStart = decode_field<int16_t>(buffer, 32, swap);
+    bh->sweepFreqEnd = decode_field<int16_t>(buffer, 34, swap);
+    bh->sweepLength = decode_field<int16_t>(buffer, 36, swap);
+    bh->sweepTypeCode = decode_field<int16_t>(buffer, 38, swap);
+    bh->traceNumSweepChannel = decode_field<int16_t>(buffer, 40, swap);
+    bh->sweepTaperLengthStart = decode_field<int16_t>(buffer, 42, swap);
+    bh->sweepTaperLengthEnd = decode_field<int16_t>(buffer, 44, swap);
+    bh->taperType = decode_field<int16_t>(buffer, 46, swap);
+    bh->correlatedData = decode_field<int16_t>(buffer, 48, swap);
+    bh->binaryGain = decode_field<int16_t>(buffer, 50, swap);
+    bh->amplitudeRecoverMethod = decode_field<int16_t>(buffer, 52, swap);
+    bh->measurementSys = decode_field<int16_t>(buffer, 54, swap);
+    bh->impulseSignalPolarity = decode_field<int16_t>(buffer, 56, swap);
+    bh->vibratoryPolarityCode = decode_field<int16_t>(buffer, 58, swap);
+    bh->extendedNumDataTraces = decode_field<int32_t>(buffer, 60, swap);
+    bh->extendedNumAuxTraces = decode_field<int32_t>(buffer, 64, swap);
+    bh->extendedNumSamplesPerEnsemble = decode_field<int32_t>(buffer, 68, swap);
+    bh->extendedSampleInterval = decode_field<int64_t>(buffer, 72, swap);
+    bh->extendedSampleIntervalOriginal = decode_field<int64_t>(buffer, 80, swap);
+    bh->extendedNumSamplesPerTrace = decode_field<int32_t>(buffer, 88, swap);
+    bh->extendedEnsembleFold = decode_field<int32_t>(buffer, 92, swap);
+    bh->integerConstant = decode_field<int32_t>(buffer, 96, swap);
+    bh->majorRevNum = decode_field<int8_t>(buffer, 300, false);
+    bh->minorRevNum = decode_field<int8_t>(buffer, 301, false);
+    bh->fixedLengthTrace = decode_field<int16_t>(buffer, 302, swap);
+    bh->numExtendedTextHeaders = decode_field<int16_t>(buffer, 304, swap);
+    bh->maxNumAdditionalTraceHeaders = decode_field<int32_t>(buffer, 306, swap);
+    bh->timeBasisCode = decode_field<int16_t>(buffer, 310, swap);
+    bh->numOfTracesInFile = decode_field<int64_t>(buffer, 312, swap);
+    bh->offsetFirstTrace = decode_field<int64_t>(buffer, 320, swap);
+    bh->numTrailerStanzaRecs = decode_field<int32_t>(buffer, 328, swap);
+    memcpy(bh->unassigned_one, buffer + 100, sizeof(bh->unassigned_one));
+    memcpy(bh->unassigned_two, buffer + 332, sizeof(bh->unassigned_two));
 
-  f_header->radar_type = shift_endianness<int16_t>(f_header->radar_type);
-  f_header->year = shift_endianness<int16_t>(f_header->year);
-  f_header->month = shift_endianness<int16_t>(f_header->month);
-  f_header->day = shift_endianness<int16_t>(f_header->day);
-  f_header->dimension = shift_endianness<int16_t>(f_header->dimension);
-  f_header->data_offset = shift_endianness<int16_t>(f_header->data_offset);
-  f_header->time_window = shift_endianness<float>(f_header->time_window);
-  f_header->total_x = shift_endianness<float>(f_header->total_x);
-  f_header->total_y = shift_endianness<float>(f_header->total_y);
-  f_header->sample_size = shift_endianness<int16_t>(f_header->sample_size);
-  f_header->dielectric_coeff = shift_endianness<float>(f_header->dielectric_coeff);
-  f_header->interval_x = shift_endianness<float>(f_header->interval_x);
-  f_header->interval_y = shift_endianness<float>(f_header->interval_y);
+}
+
+
+/* Private funct. Decodes a packed SEGY_TRACE_HEADER_SIZE byte trace header into a SegyTraceHeader instance's fields.
+*/
+void decode_segy_th(const uint8_t* buffer, SegyTraceHeader* th, bool swap){
+
+    th->traceSequenceNumInLine = decode_field<int32_t>(buffer, 0, swap);
+    th->traceSequenceNumInFile = decode_field<int32_t>(buffer, 4, swap);
+    th->originalRecordNum = decode_field<int32_t>(buffer, 8, swap);
+    th->traceNumInOriginalRecord = decode_field<int32_t>(buffer, 12, swap);
+    th->energySourcePoint = decode_field<int32_t>(buffer, 16, swap);
+    th->ensembleNum = decode_field<int32_t>(buffer, 20, swap);
+    th->traceNumInEnsemble = decode_field<int32_t>(buffer, 24, swap);
+    th->traceIdCode = decode_field<int16_t>(buffer, 28, swap);
+    th->verticallySummedTraces = decode_field<int16_t>(buffer, 30, swap);
+    th->horizontallySummedTraces = decode_field<int16_t>(buffer, 32, swap);
+    th->dataUse = decode_field<int16_t>(buffer, 34, swap);
+    th->distanceFromCenter = decode_field<int32_t>(buffer, 36, swap);
+    th->receiverElevation = decode_field<int32_t>(buffer, 40, swap);
+    th->surfaceElevation = decode_field<int32_t>(buffer, 44, swap);
+    th->sourceDepth = decode_field<int32_t>(buffer, 48, swap);
+    th->datumElevationReceiver = decode_field<int32_t>(buffer, 52, swap);
+    th->datumElevationSource = decode_field<int32_t>(buffer, 56, swap);
+    th->waterDepthSource = decode_field<int32_t>(buffer, 60, swap);
+    th->waterDepthGroup = decode_field<int32_t>(buffer, 64, swap);
+    th->scalar = decode_field<int16_t>(buffer, 68, swap);
+    th->scalarCoordinates = decode_field<int16_t>(buffer, 70, swap);
+    th->sourceCoordinateX = decode_field<int32_t>(buffer, 72, swap);
+    th->sourceCoordinateY = decode_field<int32_t>(buffer, 76, swap);
+    th->groupCoordinateX = decode_field<int32_t>(buffer, 80, swap);
+    th->groupCoordinateY = decode_field<int32_t>(buffer, 84, swap);
+    th->coordinateUnits = decode_field<int16_t>(buffer, 88, swap);
+    th->weatheringVelocity = decode_field<int16_t>(buffer, 90, swap);
+    th->subweatheringVelocity = decode_field<int16_t>(buffer, 92, swap);
+    th->upholeTimeSource = decode_field<int16_t>(buffer, 94, swap);
+    th->upholeTimeGroup = decode_field<int16_t>(buffer, 96, swap);
+    th->sourceStaticCorrection = decode_field<int16_t>(buffer, 98, swap);
+    th->groupStaticCorrection = decode_field<int16_t>(buffer, 100, swap);
+    th->totalStaticApplied = decode_field<int16_t>(buffer, 102, swap);
+    th->lagTimeA = decode_field<int16_t>(buffer, 104, swap);
+    th->lagTimeB = decode_field<int16_t>(buffer, 106, swap);
+    th->delay = decode_field<int16_t>(buffer, 108, swap);
+    th->muteTimeStart = decode_field<int16_t>(buffer, 110, swap);
+    th->muteTimeEnd = decode_field<int16_t>(buffer, 112, swap);
+    th->numSamples = decode_field<int16_t>(buffer, 114, swap);
+    th->sampleInterval = decode_field<int16_t>(buffer, 116, swap);
+    th->gainType = decode_field<int16_t>(buffer, 118, swap);
+    th->instrumentGainConstant = decode_field<int16_t>(buffer, 120, swap);
+    th->instrumentInitialGain = decode_field<int16_t>(buffer, 122, swap);
+    th->correlated = decode_field<int16_t>(buffer, 124, swap);
+    th->sweepFreqStart = decode_field<int16_t>(buffer, 126, swap);
+    th->sweepFreqEnd = decode_field<int16_t>(buffer, 128, swap);
+    th->sweepLength = decode_field<int16_t>(buffer, 130, swap);
+    th->sweepType = decode_field<int16_t>(buffer, 132, swap);
+    th->sweepTraceLenghtStart = decode_field<int16_t>(buffer, 134, swap);
+    th->sweepTraceLengthEnd = decode_field<int16_t>(buffer, 136, swap);
+    th->taperType = decode_field<int16_t>(buffer, 138, swap);
+    th->aliasFilterFreq = decode_field<int16_t>(buffer, 140, swap);
+    th->aliasFilterSlope = decode_field<int16_t>(buffer, 142, swap);
+    th->notchFilterFreq = decode_field<int16_t>(buffer, 144, swap);
+    th->notchFilterSlope = decode_field<int16_t>(buffer, 146, swap);
+    th->lowCutFreq = decode_field<int16_t>(buffer, 148, swap);
+    th->highCutFreq = decode_field<int16_t>(buffer, 150, swap);
+    th->lowCutSlope = decode_field<int16_t>(buffer, 152, swap);
+    th->highCutSlope = decode_field<int16_t>(buffer, 154, swap);
+    th->year = decode_field<int16_t>(buffer, 156, swap);
+    th->day = decode_field<int16_t>(buffer, 158, swap);
+    th->hour = decode_field<int16_t>(buffer, 160, swap);
+    th->minute = decode_field<int16_t>(buffer, 162, swap);
+    th->second = decode_field<int16_t>(buffer, 164, swap);
+    th->timeBasisCode = decode_field<int16_t>(buffer, 166, swap);
+    th->traceWeightFactor = decode_field<int16_t>(buffer, 168, swap);
+    th->geophoneRollSwitch = decode_field<int16_t>(buffer, 170, swap);
+    th->geophoneTraceFirst = decode_field<int16_t>(buffer, 172, swap);
+    th->geophoneTraceLast = decode_field<int16_t>(buffer, 174, swap);
+    th->gapSize = decode_field<int16_t>(buffer, 176, swap);
+    th->overTravel = decode_field<int16_t>(buffer, 178, swap);
+    th->ensembleX = decode_field<int32_t>(buffer, 180, swap);
+    th->ensembleY = decode_field<int32_t>(buffer, 184, swap);
+    th->inLineNum = decode_field<int32_t>(buffer, 188, swap);
+    th->crossLineNum = decode_field<int32_t>(buffer, 192, swap);
+    th->shotPoint = decode_field<int32_t>(buffer, 196, swap);
+    th->scalarToShotPoint = decode_field<int16_t>(buffer, 200, swap);
+    th->traceMeasurementUnit = decode_field<int16_t>(buffer, 202, swap);
+    th->transductionMantissa = decode_field<int32_t>(buffer, 204, swap);
+    th->transductionPower = decode_field<int16_t>(buffer, 208, swap);
+    th->transductionUnits = decode_field<int16_t>(buffer, 210, swap);
+    th->deviceId = decode_field<int16_t>(buffer, 212, swap);
+    th->scalarTimes = decode_field<int16_t>(buffer, 214, swap);
+    th->sourceOrientation = decode_field<int16_t>(buffer, 216, swap);
+    th->sourceEnergyDirectioneMantissa = decode_field<int32_t>(buffer, 218, swap);
+    th->sourceEnergyDirectionPower = decode_field<int16_t>(buffer, 222, swap);
+    th->sourceMeasurementMantissa = decode_field<int32_t>(buffer, 224, swap);
+    th->sourceMeasurementExponent = decode_field<int16_t>(buffer, 228, swap);
+    th->sourceMeasurementUnit = decode_field<int16_t>(buffer, 230, swap);
+    memcpy(th->unassigned_three, buffer + 232, sizeof(th->unassigned_three));
 
 }
 
 
-/* Shifts a VER_2018-version trace header's endianness.
+/* -------------------------------Block codec----------------------------------------------------------------- */
+
+/* Private. LSB-first bit stream writer of the COMPRESSION_FAST coder
+*/
+struct LiberadBitWriter{
+
+  std::vector<uint8_t>* out = nullptr;
+  uint64_t bits = 0;
+  int count = 0;
+
+  void put(uint32_t value, int size){
+    bits |= static_cast<uint64_t>(value) << count;
+    count += size;
+    while (count >= 8){
+      out->push_back(static_cast<uint8_t>(bits));
+      bits >>= 8;
+      count -= 8;
+    }
+  }
+
+  void flush(){
+    if (count > 0){
+      out->push_back(static_cast<uint8_t>(bits));
+    }
+    bits = 0;
+    count = 0;
+  }
+
+};
+
+
+/* Private. LSB-first bit stream reader of the COMPRESSION_FAST coder. Reads zeros past the end, which callers detect
+* through overrun().
+*/
+struct LiberadBitReader{
+
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  size_t position = 0;
+  uint64_t bits = 0;
+  int count = 0;
+
+  void refill(){
+    while (count <= 56){
+      uint64_t byte = (position < size) ? data[position] : 0;
+      position++;
+      bits |= byte << count;
+      count += 8;
+    }
+  }
+
+  uint32_t get(int size){
+    refill();
+    uint32_t value = static_cast<uint32_t>(bits & ((1u << size) - 1));
+    bits >>= size;
+    count -= size;
+    return value;
+  }
+
+  // number of consecutive 1 bits, at most limit. Consumes the terminating 0 bit below limit
+  int unary(int limit){
+    refill();
+    int ones = __builtin_ctzll(~bits);
+    ones = (ones < limit) ? ones : limit;
+    int used = (ones < limit) ? ones + 1 : limit;
+    bits >>= used;
+    count -= used;
+    return ones;
+  }
+
+  bool overrun(){
+    return position - count / 8 > size;
+  }
+
+};
+
+
+/* Private. Adaptive binary range coder (LZMA style) of the COMPRESSION_HIGH coder
+*/
+struct LiberadRangeEncoder{
+
+  std::vector<uint8_t>* out = nullptr;
+  uint64_t low = 0;
+  uint32_t range = 0xFFFFFFFF;
+  uint8_t cache = 0;
+  int64_t cache_size = 1;
+
+  void shift_low(){
+    if (static_cast<uint32_t>(low) < 0xFF000000u || (low >> 32) != 0){
+      uint8_t carry = static_cast<uint8_t>(low >> 32);
+      uint8_t temp = cache;
+      do {
+        out->push_back(static_cast<uint8_t>(temp + carry));
+        temp = 0xFF;
+      } while (--cache_size != 0);
+      cache = static_cast<uint8_t>(low >> 24);
+    }
+    cache_size++;
+    low = (low & 0x00FFFFFF) << 8;
+  }
+
+  void encode(uint16_t* probability, int bit){
+    uint32_t bound = (range >> 11) * (*probability);
+    if (bit == 0){
+      range = bound;
+      *probability += ((1 << 11) - *probability) >> 5;
+    } else {
+      low += bound;
+      range -= bound;
+      *probability -= *probability >> 5;
+    }
+    while (range < (1u << 24)){
+      range <<= 8;
+      shift_low();
+    }
+  }
+
+  void flush(){
+    for (int i = 0; i < 5; i++){
+      shift_low();
+    }
+  }
+
+};
+
+
+/* Private. Decoder counterpart of LiberadRangeEncoder
 */
-void liberad_shift_trace_header_ver1_endianness(EradTraceHeader_VER_1* t_header){
+struct LiberadRangeDecoder{
+
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  size_t position = 0;
+  uint32_t range = 0xFFFFFFFF;
+  uint32_t code = 0;
+
+  uint8_t next(){
+    return (position < size) ? data[position++] : (position++, 0);
+  }
+
+  void init(){
+    for (int i = 0; i < 5; i++){
+      code = (code << 8) | next();
+    }
+  }
+
+  int decode(uint16_t* probability){
+    uint32_t bound = (range >> 11) * (*probability);
+    int bit;
+    if (code < bound){
+      range = bound;
+      *probability += ((1 << 11) - *probability) >> 5;
+      bit = 0;
+    } else {
+      code -= bound;
+      range -= bound;
+      *probability -= *probability >> 5;
+      bit = 1;
+    }
+    while (range < (1u << 24)){
+      range <<= 8;
+      code = (code << 8) | next();
+    }
+    return bit;
+  }
+
+};
 
-  t_header->trace_index = shift_endianness<int64_t>(t_header->trace_index);
-  t_header->sample_size = shift_endianness<int16_t>(t_header->sample_size);
-  t_header->steps_per_trace = shift_endianness<int16_t>(t_header->steps_per_trace);
-  t_header->hour = shift_endianness<int16_t>(t_header->hour);
-  t_header->minute = shift_endianness<int16_t>(t_header->minute);
-  t_header->second = shift_endianness<int16_t>(t_header->second);
-  t_header->millisecond = shift_endianness<int32_t>(t_header->millisecond);
-  t_header->fold_index = shift_endianness<int32_t>(t_header->fold_index);
-  t_header->trace_index_in_fold = shift_endianness<int32_t>(t_header->trace_index_in_fold);
-  t_header->x_local = shift_endianness<double>(t_header->x_local);
-  t_header->y_local = shift_endianness<double>(t_header->y_local);
-  t_header->z_local = shift_endianness<double>(t_header->z_local);
 
+/* Private funct. Range coder context of a residual - the magnitude class of the residual before it
+*/
+inline int liberad_residual_context(uint8_t previous){
+  return (previous == 0) ? 0 : (previous <= 2) ? 1 : (previous <= 8) ? 2 : (previous <= 32) ? 3 : 4;
 }
 
 
-/* Shifts a VER_2019-version trace header's endianness.
+/* Private funct. Compresses count traces (file layout, trace_size bytes each) onto out. Every byte is predicted by the
+* same byte of the previous trace; the zigzag mapped residuals are Rice coded in groups of LIBERAD_RICE_GROUP with a
+* per-group parameter (COMPRESSION_FAST) or range coded with an adaptive model (COMPRESSION_HIGH).
 */
-void liberad_shift_trace_header_ver2_endianness(EradTraceHeader* t_header){
+void liberad_encode_block(const uint8_t* traces, int64_t count, long int trace_size, CompressionMode mode, std::vector<uint8_t>* out){
+  int64_t total = count * trace_size;
+  vector<uint8_t> residuals(total);
+  for (int64_t i = 0; i < total; i++){
+    int8_t residual = static_cast<int8_t>(traces[i] - ((i >= trace_size) ? traces[i - trace_size] : 0));
+    residuals[i] = static_cast<uint8_t>((static_cast<uint8_t>(residual) << 1) ^ (residual >> 7));
+  }
+
+  if (mode == COMPRESSION_HIGH){
+    vector<uint16_t> model(5 * 256, 1 << 10);
+    LiberadRangeEncoder encoder;
+    encoder.out = out;
+    uint8_t previous = 0;
+    for (int64_t i = 0; i < total; i++){
+      uint16_t* probabilities = &model[liberad_residual_context(previous) * 256];
+      int node = 1;
+      for (int bit = 7; bit >= 0; bit--){
+        int value = (residuals[i] >> bit) & 1;
+        encoder.encode(&probabilities[node], value);
+        node = (node << 1) | value;
+      }
+      previous = residuals[i];
+    }
+    encoder.flush();
+    return;
+  }
 
-  t_header->trace_index = shift_endianness<int64_t>(t_header->trace_index);
-  t_header->sample_size = shift_endianness<int16_t>(t_header->sample_size);
-  t_header->steps_per_trace = shift_endianness<int16_t>(t_header->steps_per_trace);
-  t_header->millisecond = shift_endianness<int16_t>(t_header->millisecond);
-  t_header->fold_index = shift_endianness<int32_t>(t_header->fold_index);
-  t_header->trace_index_in_fold = shift_endianness<int32_t>(t_header->trace_index_in_fold);
-  t_header->x_local = shift_endianness<double>(t_header->x_local);
-  t_header->y_local = shift_endianness<double>(t_header->y_local);
-  t_header->z_local = shift_endianness<double>(t_header->z_local);
-  t_header->longitude = shift_endianness<double>(t_header->longitude);
-  t_header->latitude = shift_endianness<double>(t_header->latitude);
+  LiberadBitWriter writer;
+  writer.out = out;
+  for (int64_t first = 0; first < total; first += LIBERAD_RICE_GROUP){
+    int64_t end = (first + LIBERAD_RICE_GROUP < total) ? first + LIBERAD_RICE_GROUP : total;
+
+    // cheapest parameter - quotients of 15 and over are escaped to 8 raw bits
+    int best = 0;
+    int64_t best_cost = -1;
+    for (int k = 0; k < 8; k++){
+      int64_t cost = 0;
+      for (int64_t i = first; i < end; i++){
+        int quotient = residuals[i] >> k;
+        cost += (quotient < 15) ? quotient + 1 + k : 15 + 8;
+      }
+      if (best_cost < 0 || cost < best_cost){
+        best = k;
+        best_cost = cost;
+      }
+    }
 
+    writer.put(best, 3);
+    for (int64_t i = first; i < end; i++){
+      int quotient = residuals[i] >> best;
+      if (quotient < 15){
+        writer.put((1u << quotient) - 1, quotient + 1);
+        writer.put(residuals[i] & ((1u << best) - 1), best);
+      } else {
+        writer.put((1u << 15) - 1, 15);
+        writer.put(residuals[i], 8);
+      }
+    }
+  }
+  writer.flush();
 }
 
-/* ----------------------------------------------------------------------------------------------------------------- */
+
+/* Private funct. Decompresses a block payload written by liberad_encode_block into count traces of trace_size bytes.
+*/
+int liberad_decode_block(const uint8_t* payload, size_t size, int64_t count, long int trace_size, CompressionMode mode, uint8_t* traces){
+  int64_t total = count * trace_size;
+  bool overrun = false;
+
+  if (mode == COMPRESSION_HIGH){
+    vector<uint16_t> model(5 * 256, 1 << 10);
+    LiberadRangeDecoder decoder;
+    decoder.data = payload;
+    decoder.size = size;
+    decoder.init();
+    uint8_t previous = 0;
+    for (int64_t i = 0; i < total; i++){
+      uint16_t* probabilities = &model[liberad_residual_context(previous) * 256];
+      int node = 1;
+      for (int bit = 0; bit < 8; bit++){
+        node = (node << 1) | decoder.decode(&probabilities[node]);
+      }
+      traces[i] = static_cast<uint8_t>(node);
+      previous = traces[i];
+    }
+    overrun = decoder.position > size + 5;
+  } else if (mode == COMPRESSION_FAST){
+    LiberadBitReader reader;
+    reader.data = payload;
+    reader.size = size;
+    for (int64_t first = 0; first < total; first += LIBERAD_RICE_GROUP){
+      int64_t end = (first + LIBERAD_RICE_GROUP < total) ? first + LIBERAD_RICE_GROUP : total;
+      int k = reader.get(3);
+      for (int64_t i = first; i < end; i++){
+        int quotient = reader.unary(15);
+        traces[i] = (quotient < 15) ? static_cast<uint8_t>((quotient << k) | reader.get(k)) : static_cast<uint8_t>(reader.get(8));
+      }
+    }
+    overrun = reader.overrun();
+  } else {
+    return ERROR;
+  }
+
+  // zigzag residuals back to bytes, predicted by the previous trace
+  for (int64_t i = 0; i < total; i++){
+    int8_t residual = static_cast<int8_t>((traces[i] >> 1) ^ -(traces[i] & 1));
+    traces[i] = static_cast<uint8_t>(residual + ((i >= trace_size) ? traces[i - trace_size] : 0));
+  }
+  return overrun ? ERROR : SUCCESS;
+}
+
+
+/* -----------------------------Endianness helper functs--------------------------------------------------------------- */
 
 
 /* Returns the current system's endianness.
@@ -879,6 +5002,51 @@ EndiannessMarker liberad_get_file_endianness(int8_t* header_endianness){
 /* ----------------------------------------------------------------------------------------------------------------- */
 
 
+/* Private funct. Maps the whole file read-only into memory and applies the file's access hint.
+*/
+int liberad_map_file(LiberadFile* efile){
+  struct stat st;
+  if (fstat(fileno(efile->stream), &st) != 0 || st.st_size == 0){
+    return ERROR;
+  }
+
+  void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fileno(efile->stream), 0);
+  if (map == MAP_FAILED){
+    return ERROR;
+  }
+
+  efile->map = static_cast<uint8_t*>(map);
+  efile->map_size = st.st_size;
+  madvise(efile->map, efile->map_size, liberad_get_madvise_flag(efile->access_hint));
+  return SUCCESS;
+}
+
+
+/* Private funct. Unmaps a previously mapped file
+*/
+void liberad_unmap_file(LiberadFile* efile){
+  if (efile->map != nullptr){
+    munmap(efile->map, efile->map_size);
+    efile->map = nullptr;
+    efile->map_size = 0;
+  }
+}
+
+
+/* Helper. Returns the madvise advice matching an access hint
+*/
+int liberad_get_madvise_flag(LiberadFile::AccessHint hint){
+  if (hint == LiberadFile::LIBERAD_ACCESS_SEQUENTIAL){
+    return MADV_SEQUENTIAL;
+  } else if (hint == LiberadFile::LIBERAD_ACCESS_RANDOM){
+    return MADV_RANDOM;
+  }
+  return MADV_NORMAL;
+}
+
+/* ----------------------------------------------------------------------------------------------------------------- */
+
+
 /* Returns a human readable string with the Oerad hardware name based on its code
 */
 std::string liberad_get_radar_string(int16_t radar){
@@ -907,8 +5075,9 @@ std::string liberad_get_radar_string(int16_t radar){
 std::string liberad_get_stream_mode(LiberadFile::Mode mode){
   std::string mode_str;
   if (mode == LiberadFile::LIBERAD_APPEND){
-    mode_str = "ab";
-  } else if (mode == LiberadFile::LIBERAD_READ){
+    mode_str = "r+b";
+  } else if (mode == LiberadFile::LIBERAD_READ || mode == LiberadFile::LIBERAD_READ_MMAP ||
+             mode == LiberadFile::LIBERAD_READ_POSITIONAL){
     mode_str = "rb";
   } else {
     mode_str = "wb";
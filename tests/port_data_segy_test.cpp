@@ -0,0 +1,89 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// private liberad_port_data_segy kernels, exported by the library but not declared in its headers
+void liberad_port_data_segy_scalar(const uint8_t* data_source, int16_t* data_dest, int data_length);
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LIBERAD_HAVE_X86_SIMD
+void liberad_port_data_segy_sse2(const uint8_t* data_source, int16_t* data_dest, int data_length);
+void liberad_port_data_segy_avx2(const uint8_t* data_source, int16_t* data_dest, int data_length);
+void liberad_port_data_segy_avx512(const uint8_t* data_source, int16_t* data_dest, int data_length);
+#endif
+
+typedef void (*PortKernel)(const uint8_t* data_source, int16_t* data_dest, int data_length);
+
+#define MAX_LENGTH 600
+#define MAX_MISALIGN 64
+
+
+/* Runs kernel over every length 0..MAX_LENGTH at every source and destination misalignment and compares the output,
+* including the guard area past data_length, against the scalar reference. Returns the number of mismatches.
+*/
+int check_kernel(const char* name, PortKernel kernel){
+  // every window of 256 samples holds all byte values, and the offsets move each value across the vector lanes
+  vector<uint8_t> source(MAX_LENGTH + MAX_MISALIGN);
+  for (size_t i = 0; i < source.size(); i++){
+    source[i] = static_cast<uint8_t>(i);
+  }
+  vector<int16_t> expected(MAX_LENGTH + MAX_MISALIGN + 1);
+  vector<int16_t> actual(MAX_LENGTH + MAX_MISALIGN + 1);
+  int failures = 0;
+  for (int length = 0; length <= MAX_LENGTH; length++){
+    for (int src_offset = 0; src_offset < MAX_MISALIGN; src_offset++){
+      int dst_offset = (src_offset * 5) % MAX_MISALIGN;
+      fill(expected.begin(), expected.end(), 0x5A5A);
+      fill(actual.begin(), actual.end(), 0x5A5A);
+      liberad_port_data_segy_scalar(source.data() + src_offset, expected.data() + dst_offset, length);
+      kernel(source.data() + src_offset, actual.data() + dst_offset, length);
+      if (memcmp(expected.data(), actual.data(), actual.size() * sizeof(int16_t)) != 0){
+        if (failures == 0){
+          cout << name << ": mismatch at length " << length << ", source offset " << src_offset << endl;
+        }
+        failures++;
+      }
+    }
+  }
+  return failures;
+}
+
+
+int main(){
+  // the scalar kernel itself must match (int8_t)(x ^ 0x80) * 100 for every byte value
+  int failures = 0;
+  uint8_t all_bytes[256];
+  int16_t ported[256];
+  for (int i = 0; i < 256; i++){
+    all_bytes[i] = static_cast<uint8_t>(i);
+  }
+  liberad_port_data_segy_scalar(all_bytes, ported, 256);
+  for (int i = 0; i < 256; i++){
+    if (ported[i] != static_cast<int16_t>((i - 128) * 100)){
+      cout << "scalar: wrong value for byte " << i << endl;
+      failures++;
+    }
+  }
+
+#ifdef LIBERAD_HAVE_X86_SIMD
+  __builtin_cpu_init();
+  struct { const char* name; bool supported; PortKernel kernel; } kernels[] = {
+    {"sse2", static_cast<bool>(__builtin_cpu_supports("sse2")), liberad_port_data_segy_sse2},
+    {"avx2", static_cast<bool>(__builtin_cpu_supports("avx2")), liberad_port_data_segy_avx2},
+    {"avx512", static_cast<bool>(__builtin_cpu_supports("avx512bw")), liberad_port_data_segy_avx512},
+  };
+  for (const auto& k : kernels){
+    if (!k.supported){
+      cout << k.name << ": not supported by this CPU, skipped" << endl;
+      continue;
+    }
+    int kernel_failures = check_kernel(k.name, k.kernel);
+    cout << k.name << ": " << (kernel_failures == 0 ? "ok" : "FAILED") << endl;
+    failures += kernel_failures;
+  }
+#endif
+
+  return failures == 0 ? 0 : 1;
+}